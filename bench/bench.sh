@@ -0,0 +1,149 @@
+#!/bin/bash
+# Compiler benchmarks on generated MiniC programs.
+#
+#   bench/bench.sh [BENCHMARK...]
+#
+# Runs every benchmark when none are named. Expects a built ./mccomp; set
+# COMP to benchmark a different binary, and LLC and CXX to pick the tools
+# that build generated code.
+set -e
+
+DIR="$(cd "$(dirname "$0")" && pwd)"
+COMP=${COMP:-$DIR/../mccomp}
+LLC=${LLC:-llc}
+CXX=${CXX:-clang++}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+function generate {
+  python3 "$DIR/genminic.py" "$@"
+}
+
+# Pointer tree versus flat AST: the same summary pass written as virtual
+# methods and as a switch over node kinds.
+function ast_traversal {
+  generate 2000 mixed > "$WORK/mixed.c"
+  "$COMP" --bench-ast-traversal=50 "$WORK/mixed.c"
+}
+
+# Expression parsing: long arithmetic, comparison and logical expressions.
+function expr_parse {
+  generate 3000 expr > "$WORK/expr.c"
+  "$COMP" --syntax-only --time-phases "$WORK/expr.c" > /dev/null
+}
+
+# Binary operator lowering: IR generation for arithmetic-dense functions.
+function expr_codegen {
+  generate 3000 arith > "$WORK/arith.c"
+  "$COMP" --time-phases "$WORK/arith.c" > /dev/null
+}
+
+# Name resolution: many locals shadowed through nested blocks; see the
+# semantic analysis phase.
+function name_resolution {
+  generate 1500 scopes > "$WORK/scopes.c"
+  "$COMP" --time-phases "$WORK/scopes.c" > /dev/null
+}
+
+# Generated code: the loops of tests/pi, tests/factorial and tests/palindrome,
+# compiled by mccomp at $OPT (default -O2) and by llc with no further IR
+# optimization, timed by loops.cpp.
+function test_loops {
+  for T in pi factorial palindrome; do
+    "$COMP" ${OPT:--O2} "$DIR/../tests/$T/$T.c" > /dev/null 2>&1
+    "$LLC" -O2 -relocation-model=pic -filetype=obj output.ll -o "$T.o"
+  done
+  "$CXX" -O2 "$DIR/loops.cpp" pi.o factorial.o palindrome.o -o loops
+  ./loops
+}
+
+# Object emission: writing output.ll and running llc on it, versus emitting
+# the object file in-process with -c. Unoptimized, so the optimizer does not
+# drown out the difference.
+function emit_object {
+  generate 3000 arith > "$WORK/arith.c"
+  TIMEFORMAT="  %R s wall"
+  echo "mccomp, then llc"
+  time { "$COMP" "$WORK/arith.c" > /dev/null 2>&1
+         "$LLC" -O0 -mcpu=native -relocation-model=pic -filetype=obj output.ll -o arith.o; }
+  echo "mccomp -c"
+  time "$COMP" -c -o arith.o "$WORK/arith.c" > /dev/null 2>&1
+}
+
+# Module output: textual IR versus bitcode, written to and parsed back from
+# memory, for growing modules.
+function module_io {
+  for N in 250 1000 4000; do
+    generate $N arith > "$WORK/arith$N.c"
+    "$COMP" --bench-module-io=5 "$WORK/arith$N.c" 2>&1 > /dev/null |
+      grep -v Finished
+  done
+}
+
+# Edit-run cycle: compiling tests/pi, building its driver and running it,
+# versus compiling it in memory and calling pi() with --run.
+function run_jit {
+  cp "$DIR/../tests/pi/pi.c" "$DIR/../tests/pi/driver.cpp" .
+  TIMEFORMAT="  %R s wall"
+  echo "mccomp, llc, $CXX, run"
+  time { "$COMP" ${OPT:--O2} pi.c > /dev/null 2>&1
+         "$LLC" -O2 -relocation-model=pic -filetype=obj output.ll -o pi.o
+         "$CXX" driver.cpp pi.o -o pi
+         ./pi > /dev/null; }
+  echo "mccomp --run"
+  time "$COMP" ${OPT:--O2} --run=pi pi.c > /dev/null 2>&1
+}
+
+# Lazy JIT: time to the result of --run on a tree of 200 calling functions,
+# compiling all of them up front versus each as it is first called, for a
+# leaf that calls nothing and for the root that calls everything.
+function jit_lazy {
+  generate 200 calls > "$WORK/calls.c"
+  TIMEFORMAT="  %R s wall"
+  for F in f199 f0; do
+    for MODE in --run-eager --jit-threads=0 --jit-threads=2; do
+      echo "--run=$F $MODE"
+      time "$COMP" ${OPT:--O2} $MODE --run=$F "$WORK/calls.c" 1 2 > /dev/null 2>&1
+    done
+  done
+}
+
+# Object cache: --run on the tree of 200 functions from an empty --jit-cache,
+# then again with the cache filled and other arguments, compiling eagerly and
+# lazily.
+function jit_cache {
+  generate 200 calls > "$WORK/calls.c"
+  TIMEFORMAT="  %R s wall"
+  for MODE in --run-eager --jit-threads=2; do
+    rm -rf "$WORK/jit-cache"
+    for START in "cold 1 2" "warm 3 4"; do
+      set -- $START
+      echo "--run=f0 $2 $3 $MODE, $1"
+      time "$COMP" ${OPT:--O2} --run=f0 $MODE --jit-cache="$WORK/jit-cache" \
+        "$WORK/calls.c" $2 $3 > /dev/null 2>&1
+    done
+  done
+}
+
+# Bytecode interpreter: --run compiled by the JIT versus --run --interpret on
+# the kernels of tests/, for calls that do little work, where start-up
+# dominates, and for calls that loop or recurse for long, where it does not.
+function interp {
+  TIMEFORMAT="  %R s wall"
+  for K in "pi" "palindrome 123454321" "factorial 10" "factorial 100000000" \
+           "rfact 10" "rfact 1000000"; do
+    set -- $K
+    T=$1
+    shift
+    for MODE in "${OPT:--O2}" --interpret; do
+      echo "--run=$T $* $MODE"
+      time "$COMP" $MODE --run=$T "$DIR/../tests/$T/$T.c" "$@" > /dev/null 2>&1
+    done
+  done
+}
+
+BENCHMARKS=${@:-ast_traversal expr_parse expr_codegen name_resolution test_loops emit_object module_io run_jit jit_lazy jit_cache interp}
+for B in $BENCHMARKS; do
+  echo "***** $B"
+  (cd "$WORK" && $B)
+done
@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+# Generate large MiniC programs for the benchmarks in bench.sh.
+#
+#   genminic.py FUNCTIONS [STYLE] > out.c
+#
+# STYLE is one of
+#   mixed  declarations, arithmetic, if/else and while loops (default)
+#   expr   long arithmetic, comparison and logical expressions
+#   arith  long int and float arithmetic expressions that all type check
+#   scopes many locals in nested blocks, shadowing each other
+#   calls  a binary tree of calls rooted at f0, safe to run
+import random
+import sys
+
+
+def expr(depth, leaves=("x", "y", "a", "b")):
+    if depth == 0:
+        return random.choice(list(leaves) + [str(random.randint(1, 99))])
+    op = random.choice(["+", "-", "*", "/", "+", "-", "*"])
+    return "(%s %s %s)" % (expr(depth - 1, leaves), op, expr(depth - 1, leaves))
+
+
+def cond():
+    return "(%s %s %s)" % (expr(1), random.choice(["<", ">", "<=", ">=", "==", "!="]), expr(1))
+
+
+def mixed(f):
+    print("int f%d(int a, int b) {" % f)
+    print("  int x; int y; float z;")
+    print("  x = a; y = b; z = 1.5;")
+    for _ in range(8):
+        print("  x = %s;" % " + ".join("(x * %d - y / %d)" % (random.randint(1, 9), random.randint(1, 9)) for _ in range(4)))
+        print("  if (x > y) { y = y + 1; } else { x = x - 1; }")
+        print("  while (y < %d) { y = y + 2; }" % random.randint(1, 100))
+    print("  return x;\n}")
+
+
+def exprs(f):
+    print("int f%d(int a, int b) {" % f)
+    print("  int x; int y; bool c;")
+    print("  x = a; y = b;")
+    for _ in range(8):
+        print("  x = %s;" % expr(4))
+        print("  c = %s && %s || %s;" % (cond(), cond(), cond()))
+    print("  return x;\n}")
+
+
+def arith(f):
+    print("int f%d(int a, int b) {" % f)
+    print("  int x; int y; float z;")
+    print("  x = a; y = b; z = 0.5;")
+    for _ in range(8):
+        print("  x = %s;" % expr(5))
+        print("  z = %s;" % expr(4, ("z", "x", "1.5")))
+    print("  return x;\n}")
+
+
+def scopes(f):
+    print("int f%d(int a, int b) {" % f)
+    names = ["v%d" % i for i in range(64)]
+    print("  int %s;" % "; int ".join(names))
+    print("  %s = a;" % " = ".join(names))
+    for depth in range(6):
+        inner = random.sample(names, 16)
+        print("  " * (depth + 1) + "{ int %s;" % "; int ".join(inner))
+        for _ in range(6):
+            print("  " * (depth + 2) + "%s = %s;" % (random.choice(names), expr(3, random.sample(names, 8))))
+    print("  " * 6 + "}" * 6)
+    print("  return v0;\n}")
+
+
+def calls(f, count):
+    print("int f%d(int a, int b) {" % f)
+    print("  int x; int y;")
+    print("  x = a; y = b;")
+    for _ in range(8):
+        print("  x = %s;" % " + ".join("(x * %d - y / %d)" % (random.randint(1, 9), random.randint(1, 9)) for _ in range(4)))
+        print("  if (x > y) { y = y + 1; } else { x = x - 1; }")
+    for callee in (2 * f + 1, 2 * f + 2):
+        if callee < count:
+            print("  x = x - f%d(y, x / %d);" % (callee, random.randint(2, 9)))
+    print("  return x;\n}")
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit("usage: genminic.py FUNCTIONS [mixed|expr|arith|scopes|calls]")
+    count = int(sys.argv[1])
+    style = sys.argv[2] if len(sys.argv) > 2 else "mixed"
+    random.seed(1)
+    print("// Generated by bench/genminic.py %d %s" % (count, style))
+    print("extern int print_int(int X);")
+    if style == "calls":
+        # Callees are defined before their callers.
+        for f in reversed(range(count)):
+            calls(f, count)
+        return
+    body = {"mixed": mixed, "expr": exprs, "arith": arith, "scopes": scopes}[style]
+    for f in range(count):
+        body(f)
+
+
+main()
@@ -0,0 +1,35 @@
+// Times the loops of the test programs as compiled by mccomp; see the
+// test_loops benchmark in bench.sh.
+//
+//   loops [ITERATIONS]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+extern "C" {
+float pi();
+int factorial(int n);
+bool palindrome(int number);
+}
+
+template <typename Fn> static void timeLoop(const char *Name, int Iterations, Fn Body) {
+  auto Start = std::chrono::steady_clock::now();
+  for (int i = 0; i < Iterations; i++)
+    Body(i);
+  std::chrono::duration<double, std::nano> Elapsed =
+      std::chrono::steady_clock::now() - Start;
+  printf("%-12s %10.1f ns/call\n", Name, Elapsed.count() / Iterations);
+}
+
+int main(int argc, char **argv) {
+  int Iterations = argc > 1 ? atoi(argv[1]) : 200000;
+  volatile float FloatSink;
+  volatile int IntSink;
+
+  timeLoop("pi", Iterations, [&](int) { FloatSink = pi(); });
+  timeLoop("factorial", Iterations, [&](int i) { IntSink = factorial(i % 13); });
+  timeLoop("palindrome", Iterations,
+           [&](int i) { IntSink = palindrome(123321 + i); });
+  return 0;
+}
@@ -1,6 +1,24 @@
 #include "llvm/ADT/APFloat.h"
 #include "llvm/ADT/Optional.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Analysis/ModuleSummaryAnalysis.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/ExecutionEngine/JITSymbol.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/ExecutionEngine/Orc/CompileUtils.h"
+#include "llvm/ExecutionEngine/Orc/Core.h"
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
@@ -10,23 +28,48 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/ModuleSummaryIndex.h"
 #include "llvm/IR/Type.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/MC/MCSubtargetInfo.h"
+#include "llvm/MC/SubtargetFeature.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/CachePruning.h"
+#include "llvm/Support/Chrono.h"
+#include "llvm/Support/CodeGen.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/Host.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetOptions.h"
 #include <algorithm>
 #include <cassert>
 #include <cctype>
+#include <chrono>
+#include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <queue>
 #include <string.h>
 #include <string>
@@ -34,30 +77,58 @@
 #include <utility>
 #include <vector>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define MCCOMP_X86_SIMD 1
+#endif
+
 using namespace llvm;
 using namespace llvm::sys;
 
-bool lineneeded = true;
-int inrhs = 0;
-bool exprbool = false;
-bool usestart = true;
 
-int errorCount = 0;
-int assign = 0;
-int indentation = 0;
-std::string indent = "    ";
-bool isrhsorlhs = false;
+//===----------------------------------------------------------------------===//
+// Source Buffer
+//===----------------------------------------------------------------------===//
 
-std::string getIndent(){
-  std::string id = "";
-  for (size_t i = 0; i < indentation; i++)
-  {
-    id = id + indent;
-  }
-  return id;
-}
+/// SourceBuffer - Owns the bytes of the file being compiled. Regular files are
+/// memory mapped by MemoryBuffer, stdin and pipes are pulled in with a single
+/// bulk read. The contents are always NUL terminated, so the lexer can walk a
+/// raw pointer over them and treat the terminator as its end of input.
+class SourceBuffer {
+  std::unique_ptr<MemoryBuffer> Buffer;
+  mutable std::vector<uint32_t> LineOffsets; // Built on the first diagnostic
 
-FILE *pFile;
+  SourceBuffer(std::unique_ptr<MemoryBuffer> Buf) : Buffer(std::move(Buf)) {}
+
+public:
+  /// open - Map the named file, or read standard input if Filename is "-".
+  static ErrorOr<std::unique_ptr<SourceBuffer>> open(StringRef Filename) {
+    auto BufOrErr = MemoryBuffer::getFileOrSTDIN(Filename);
+    if (!BufOrErr)
+      return BufOrErr.getError();
+    return std::unique_ptr<SourceBuffer>(new SourceBuffer(std::move(*BufOrErr)));
+  }
+
+  const char *begin() const { return Buffer->getBufferStart(); }
+  const char *end() const { return Buffer->getBufferEnd(); }
+  size_t size() const { return Buffer->getBufferSize(); }
+  StringRef getName() const { return Buffer->getBufferIdentifier(); }
+
+  /// getLineAndColumn - Translate a byte offset into a 1-based line and column.
+  /// The table of line start offsets is only built the first time a
+  /// diagnostic asks for a location, so error free compiles never pay for it.
+  std::pair<unsigned, unsigned> getLineAndColumn(uint32_t Offset) const {
+    if (LineOffsets.empty()) {
+      LineOffsets.push_back(0);
+      for (const char *P = begin(), *E = end(); P != E; ++P)
+        if (*P == '\n')
+          LineOffsets.push_back(P - begin() + 1);
+    }
+    auto Line = std::upper_bound(LineOffsets.begin(), LineOffsets.end(), Offset);
+    unsigned LineNo = Line - LineOffsets.begin();
+    return {LineNo, Offset - *(Line - 1) + 1};
+  }
+};
 
 //===----------------------------------------------------------------------===//
 // Lexer
@@ -125,356 +196,961 @@ enum TOKEN_TYPE {
 };
 
 
-// TOKEN struct is used to keep track of information about a token
+// TOKEN struct is used to keep track of information about a token. It is a
+// span of the source buffer rather than a copy of the lexeme, so tokens are
+// cheap to copy around the parser and into the AST. Line and column numbers
+// are recovered from the offset only when a diagnostic needs them.
 struct TOKEN {
   int type = -100;
-  std::string lexeme;
-  int lineNo;
-  int columnNo;
-};
+  uint32_t offset = 0; // Byte offset of the lexeme in its SourceBuffer
+  uint32_t length = 0; // Length of the lexeme in bytes
+  uint32_t symbol = 0; // Interned identifier id, filled in if IDENT
 
-static std::string IdentifierStr; // Filled in if IDENT
-static int IntVal;                // Filled in if INT_LIT
-static bool BoolVal;              // Filled in if BOOL_LIT
-static float FloatVal;            // Filled in if FLOAT_LIT
-static std::string StringVal;     // Filled in if String Literal
-static int lineNo, columnNo;
+  StringRef getLexeme(const SourceBuffer &Source) const {
+    return StringRef(Source.begin() + offset, length);
+  }
+};
 
-static TOKEN returnTok(std::string lexVal, int tok_type) {
-  TOKEN return_tok;
-  return_tok.lexeme = lexVal;
-  return_tok.type = tok_type;
-  return_tok.lineNo = lineNo;
-  return_tok.columnNo = columnNo - lexVal.length() - 1;
-  return return_tok;
+/// getTokenSpelling - The fixed spelling of keyword and operator tokens, for
+/// code that has a token but not the buffer it was lexed from.
+static StringRef getTokenSpelling(int type) {
+  switch (type) {
+  case INT_TOK: return "int";
+  case VOID_TOK: return "void";
+  case FLOAT_TOK: return "float";
+  case BOOL_TOK: return "bool";
+  case EXTERN: return "extern";
+  case IF: return "if";
+  case ELSE: return "else";
+  case WHILE: return "while";
+  case RETURN: return "return";
+  case AND: return "&&";
+  case OR: return "||";
+  case EQ: return "==";
+  case NE: return "!=";
+  case LE: return "<=";
+  case GE: return ">=";
+  case ASSIGN: return "=";
+  case LBRA: return "{";
+  case RBRA: return "}";
+  case LPAR: return "(";
+  case RPAR: return ")";
+  case SC: return ";";
+  case COMMA: return ",";
+  case PLUS: return "+";
+  case MINUS: return "-";
+  case ASTERIX: return "*";
+  case DIV: return "/";
+  case MOD: return "%";
+  case NOT: return "!";
+  case LT: return "<";
+  case GT: return ">";
+  default: return "";
+  }
 }
 
-// Read file line by line -- or look for \n and if found add 1 to line number
-// and reset column number to 0
-/// gettok - Return the next token from standard input.
-static TOKEN gettok() {
+/// StringInterner - Hands out a dense integer id for each distinct identifier.
+/// Names are hashed once, when the lexer first sees them, and everything after
+/// the lexer (parser, scoping and codegen) keys on the id instead of a string.
+/// Id 0 is the empty name, which is what tokens that are not identifiers carry.
+/// Each translation unit has a table of its own, which lives as long as its
+/// AST, so a process that compiles many units keeps none of their names and
+/// units compiled on separate threads share nothing. A table is only ever
+/// used by one thread; lexing in parallel chunks interns into one table per
+/// chunk and merges them afterwards.
+class StringInterner {
+  StringMap<unsigned> Ids;
+  std::vector<StringRef> Names; // Indexed by id, spelling owned by Ids
+
+public:
+  StringInterner() { intern(""); }
+
+  unsigned intern(StringRef Name) {
+    auto Inserted = Ids.try_emplace(Name, Names.size());
+    if (Inserted.second)
+      Names.push_back(Inserted.first->getKey());
+    return Inserted.first->getValue();
+  }
+
+  StringRef getName(unsigned Id) const { return Names[Id]; }
+  unsigned size() const { return Names.size(); }
+};
+
+// Keywords are recognised with a perfect hash over the first character, the
+// last character and the length of the identifier. The hash is collision free
+// for the keyword set, which is checked at compile time below, so a lookup is
+// one table load and at most one string comparison.
+struct Keyword {
+  const char *Spelling;
+  unsigned Length;
+  int Type;
+};
+
+static constexpr Keyword Keywords[] = {
+    {"int", 3, INT_TOK},   {"bool", 4, BOOL_TOK},  {"float", 5, FLOAT_TOK},
+    {"void", 4, VOID_TOK}, {"extern", 6, EXTERN},  {"if", 2, IF},
+    {"else", 4, ELSE},     {"while", 5, WHILE},    {"return", 6, RETURN},
+    {"true", 4, BOOL_LIT}, {"false", 5, BOOL_LIT},
+};
+static constexpr unsigned NumKeywords = sizeof(Keywords) / sizeof(Keywords[0]);
+static constexpr unsigned KeywordTableSize = 32;
 
-  static int LastChar = ' ';
-  static int NextChar = ' ';
+static constexpr unsigned keywordHash(unsigned char First, unsigned char Last,
+                                      size_t Length) {
+  return (First + Last + Length) & (KeywordTableSize - 1);
+}
 
-  // Skip any whitespace.
-  while (isspace(LastChar)) {
-    if (LastChar == '\n' || LastChar == '\r') {
-      lineNo++;
-      columnNo = 1;
+struct KeywordTable {
+  signed char Slot[KeywordTableSize] = {};
+  bool Perfect = true;
+
+  constexpr KeywordTable() {
+    for (unsigned i = 0; i < KeywordTableSize; i++)
+      Slot[i] = -1;
+    for (unsigned i = 0; i < NumKeywords; i++) {
+      const Keyword &K = Keywords[i];
+      unsigned H = keywordHash(K.Spelling[0], K.Spelling[K.Length - 1], K.Length);
+      if (Slot[H] != -1)
+        Perfect = false;
+      Slot[H] = i;
     }
-    LastChar = getc(pFile);
-    columnNo++;
   }
+};
+
+static constexpr KeywordTable KeywordSlots;
+static_assert(KeywordSlots.Perfect, "keyword hash has collisions");
+
+/// lookupKeyword - Return the token type of Ident if it is a keyword, or IDENT.
+static int lookupKeyword(StringRef Ident) {
+  if (Ident.size() < 2 || Ident.size() > 6)
+    return IDENT;
+  int Slot = KeywordSlots.Slot[keywordHash(Ident.front(), Ident.back(), Ident.size())];
+  if (Slot < 0)
+    return IDENT;
+  const Keyword &K = Keywords[Slot];
+  if (Ident != StringRef(K.Spelling, K.Length))
+    return IDENT;
+  return K.Type;
+}
+
+// Literal values are decoded from the token's lexeme when the parser builds
+// the literal node, rather than being stashed in lexer globals.
+static int getIntValue(StringRef Lexeme) {
+  int Val = 0;
+  for (char C : Lexeme)
+    Val = Val * 10 + (C - '0');
+  return Val;
+}
+
+static float getFloatValue(StringRef Lexeme) {
+  return strtof(Lexeme.str().c_str(), nullptr);
+}
+
+static bool getBoolValue(StringRef Lexeme) { return Lexeme == "true"; }
+
+//===----------------------------------------------------------------------===//
+// Character class scanners
+//===----------------------------------------------------------------------===//
+
+// The inner loops of gettok() - whitespace, identifier tails, digit runs and
+// line comments - are run by these scanners. Each returns the first character
+// at or after P that ends the run, and never reads past End. The SIMD versions
+// classify 16 or 32 bytes per step with character class masks and finish the
+// last partial block with the scalar loop, which is also used on its own when
+// the CPU has no vector unit we know about.
+
+static inline bool isSpaceChar(unsigned char C) {
+  return C == ' ' || (C >= '\t' && C <= '\r');
+}
+static inline bool isIdentChar(unsigned char C) {
+  return isalnum(C) || C == '_';
+}
+static inline bool isDigitChar(unsigned char C) { return C >= '0' && C <= '9'; }
+static inline bool isLineEnd(unsigned char C) { return C == '\n' || C == '\r'; }
+
+static const char *skipSpaceScalar(const char *P, const char *End) {
+  while (P != End && isSpaceChar(*P))
+    P++;
+  return P;
+}
+static const char *skipIdentScalar(const char *P, const char *End) {
+  while (P != End && isIdentChar(*P))
+    P++;
+  return P;
+}
+static const char *skipDigitsScalar(const char *P, const char *End) {
+  while (P != End && isDigitChar(*P))
+    P++;
+  return P;
+}
+static const char *skipToLineEndScalar(const char *P, const char *End) {
+  while (P != End && !isLineEnd(*P))
+    P++;
+  return P;
+}
+
+#ifdef MCCOMP_X86_SIMD
+// Byte lanes are compared as signed values, so bytes >= 0x80 never fall in an
+// ASCII range and correctly end every run.
+static inline __m128i inRange16(__m128i V, char Lo, char Hi) {
+  return _mm_and_si128(_mm_cmpgt_epi8(V, _mm_set1_epi8(Lo - 1)),
+                       _mm_cmplt_epi8(V, _mm_set1_epi8(Hi + 1)));
+}
+static inline __m128i spaceMask16(__m128i V) {
+  return _mm_or_si128(_mm_cmpeq_epi8(V, _mm_set1_epi8(' ')),
+                      inRange16(V, '\t', '\r'));
+}
+static inline __m128i identMask16(__m128i V) {
+  __m128i Lower = _mm_or_si128(V, _mm_set1_epi8(0x20));
+  return _mm_or_si128(_mm_or_si128(inRange16(Lower, 'a', 'z'),
+                                   inRange16(V, '0', '9')),
+                      _mm_cmpeq_epi8(V, _mm_set1_epi8('_')));
+}
+static inline __m128i lineEndMask16(__m128i V) {
+  return _mm_or_si128(_mm_cmpeq_epi8(V, _mm_set1_epi8('\n')),
+                      _mm_cmpeq_epi8(V, _mm_set1_epi8('\r')));
+}
+
+/// SSE2_SKIP - Skip 16 byte blocks while every byte is in the class, then
+/// return the position of the first byte that is not.
+#define SSE2_SKIP(NAME, MASK, INVERT, SCALAR)                                   \
+  static const char *NAME(const char *P, const char *End) {                    \
+    while (End - P >= 16) {                                                    \
+      __m128i V = _mm_loadu_si128((const __m128i *)P);                         \
+      unsigned Stop = _mm_movemask_epi8(MASK(V));                              \
+      if (!INVERT)                                                             \
+        Stop = ~Stop & 0xFFFF;                                                 \
+      if (Stop)                                                                \
+        return P + __builtin_ctz(Stop);                                        \
+      P += 16;                                                                 \
+    }                                                                          \
+    return SCALAR(P, End);                                                     \
+  }
+
+SSE2_SKIP(skipSpaceSSE2, spaceMask16, false, skipSpaceScalar)
+SSE2_SKIP(skipIdentSSE2, identMask16, false, skipIdentScalar)
+SSE2_SKIP(skipToLineEndSSE2, lineEndMask16, true, skipToLineEndScalar)
+
+static const char *skipDigitsSSE2(const char *P, const char *End) {
+  while (End - P >= 16) {
+    __m128i V = _mm_loadu_si128((const __m128i *)P);
+    unsigned Stop = ~_mm_movemask_epi8(inRange16(V, '0', '9')) & 0xFFFF;
+    if (Stop)
+      return P + __builtin_ctz(Stop);
+    P += 16;
+  }
+  return skipDigitsScalar(P, End);
+}
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static inline __m256i inRange32(__m256i V, char Lo, char Hi) {
+  return _mm256_and_si256(_mm256_cmpgt_epi8(V, _mm256_set1_epi8(Lo - 1)),
+                          _mm256_cmpgt_epi8(_mm256_set1_epi8(Hi + 1), V));
+}
+AVX2 static inline __m256i spaceMask32(__m256i V) {
+  return _mm256_or_si256(_mm256_cmpeq_epi8(V, _mm256_set1_epi8(' ')),
+                         inRange32(V, '\t', '\r'));
+}
+AVX2 static inline __m256i identMask32(__m256i V) {
+  __m256i Lower = _mm256_or_si256(V, _mm256_set1_epi8(0x20));
+  return _mm256_or_si256(_mm256_or_si256(inRange32(Lower, 'a', 'z'),
+                                         inRange32(V, '0', '9')),
+                         _mm256_cmpeq_epi8(V, _mm256_set1_epi8('_')));
+}
+AVX2 static inline __m256i digitMask32(__m256i V) {
+  return inRange32(V, '0', '9');
+}
+AVX2 static inline __m256i lineEndMask32(__m256i V) {
+  return _mm256_or_si256(_mm256_cmpeq_epi8(V, _mm256_set1_epi8('\n')),
+                         _mm256_cmpeq_epi8(V, _mm256_set1_epi8('\r')));
+}
+
+/// AVX2_SKIP - The 32 byte wide version of SSE2_SKIP.
+#define AVX2_SKIP(NAME, MASK, INVERT, SCALAR)                                   \
+  AVX2 static const char *NAME(const char *P, const char *End) {               \
+    while (End - P >= 32) {                                                    \
+      __m256i V = _mm256_loadu_si256((const __m256i *)P);                      \
+      unsigned Stop = _mm256_movemask_epi8(MASK(V));                           \
+      if (!INVERT)                                                             \
+        Stop = ~Stop;                                                          \
+      if (Stop)                                                                \
+        return P + __builtin_ctz(Stop);                                        \
+      P += 32;                                                                 \
+    }                                                                          \
+    return SCALAR(P, End);                                                     \
+  }
+
+AVX2_SKIP(skipSpaceAVX2, spaceMask32, false, skipSpaceScalar)
+AVX2_SKIP(skipIdentAVX2, identMask32, false, skipIdentScalar)
+AVX2_SKIP(skipDigitsAVX2, digitMask32, false, skipDigitsScalar)
+AVX2_SKIP(skipToLineEndAVX2, lineEndMask32, true, skipToLineEndScalar)
+#endif
+
+/// Scanners - The scanner set picked for this CPU. AVX2 is used when the CPU
+/// reports it, SSE2 is the x86-64 baseline, and anything else gets the scalar
+/// loops.
+struct ScannerSet {
+  const char *(*SkipSpace)(const char *, const char *);
+  const char *(*SkipIdent)(const char *, const char *);
+  const char *(*SkipDigits)(const char *, const char *);
+  const char *(*SkipToLineEnd)(const char *, const char *);
+};
+
+static ScannerSet selectScanners() {
+#ifdef MCCOMP_X86_SIMD
+  if (__builtin_cpu_supports("avx2"))
+    return {skipSpaceAVX2, skipIdentAVX2, skipDigitsAVX2, skipToLineEndAVX2};
+  return {skipSpaceSSE2, skipIdentSSE2, skipDigitsSSE2, skipToLineEndSSE2};
+#else
+  return {skipSpaceScalar, skipIdentScalar, skipDigitsScalar,
+          skipToLineEndScalar};
+#endif
+}
+
+static const ScannerSet Scanners = selectScanners();
+
+/// TokenStream - The whole input lexed up front and stored as a structure of
+/// arrays. Token kinds sit in their own contiguous array, so the parser's
+/// lookahead checks scan them cache-linearly, and any token can be reached by
+/// index, which makes peeking and backtracking free.
+class TokenStream {
+  struct Span {
+    uint32_t Offset;
+    uint32_t Length;
+  };
+
+  std::vector<int16_t> Kinds;
+  std::vector<Span> Spans;
+  std::vector<uint32_t> SymbolIds; // Only meaningful for IDENT tokens
+
+public:
+  void reserve(size_t N) {
+    Kinds.reserve(N);
+    Spans.reserve(N);
+    SymbolIds.reserve(N);
+  }
+
+  void push_back(const TOKEN &Tok) {
+    Kinds.push_back(Tok.type);
+    Spans.push_back({Tok.offset, Tok.length});
+    SymbolIds.push_back(Tok.symbol);
+  }
+
+  void pop_back() {
+    Kinds.pop_back();
+    Spans.pop_back();
+    SymbolIds.pop_back();
+  }
+
+  size_t size() const { return Kinds.size(); }
+  int getType(size_t i) const { return Kinds[i]; }
+
+  /// append - Add the tokens of Other, renumbering its identifiers through
+  /// SymbolMap. Used to stitch together the streams of separately lexed
+  /// chunks, whose identifiers were interned into chunk-private tables.
+  void append(const TokenStream &Other, const std::vector<unsigned> &SymbolMap) {
+    Kinds.insert(Kinds.end(), Other.Kinds.begin(), Other.Kinds.end());
+    Spans.insert(Spans.end(), Other.Spans.begin(), Other.Spans.end());
+    for (size_t i = 0, e = Other.size(); i != e; ++i)
+      SymbolIds.push_back(SymbolMap[Other.SymbolIds[i]]);
+  }
+
+  TOKEN operator[](size_t i) const {
+    TOKEN Tok;
+    Tok.type = Kinds[i];
+    Tok.offset = Spans[i].Offset;
+    Tok.length = Spans[i].Length;
+    Tok.symbol = SymbolIds[i];
+    return Tok;
+  }
+};
+
+/// Lexer - Turns one source buffer, or a range of lines of it, into tokens.
+/// All of the lexer's state lives in the object, so separate translation units
+/// or separate chunks of one buffer can be lexed concurrently on separate
+/// threads. Token offsets are always relative to the start of the buffer.
+class Lexer {
+  const SourceBuffer &Source;
+  const char *CurPtr;               // Next character of Source to be lexed
+  const char *TokStart;             // First character of the token being lexed
+  const char *End;                  // End of the range being lexed
+  StringInterner &Interner;         // Where identifier ids come from
+  StringMap<unsigned> LocalSymbols; // Ids this lexer already got from Interner
+
+  TOKEN returnTok(int tok_type) {
+    TOKEN return_tok;
+    return_tok.type = tok_type;
+    return_tok.offset = TokStart - Source.begin();
+    return_tok.length = CurPtr - TokStart;
+    return return_tok;
+  }
+
+  unsigned internIdentifier(StringRef Name) {
+    auto Inserted = LocalSymbols.try_emplace(Name, 0);
+    if (Inserted.second)
+      Inserted.first->second = Interner.intern(Name);
+    return Inserted.first->second;
+  }
+
+public:
+  Lexer(const SourceBuffer &Source, StringInterner &Interner)
+      : Lexer(Source, Source.begin(), Source.end(), Interner) {}
+
+  /// Lex only [Begin, End). End must be the end of the buffer or just after a
+  /// newline, so no token can straddle it.
+  Lexer(const SourceBuffer &Source, const char *Begin, const char *End,
+        StringInterner &Interner)
+      : Source(Source), CurPtr(Begin), TokStart(Begin), End(End),
+        Interner(Interner) {}
+
+  const SourceBuffer &getSource() const { return Source; }
+
+  TOKEN gettok();
+  void lexAll(TokenStream &Stream);
+};
+
+/// gettok - Return the next token from the source range. The range ends at a
+/// newline or at the NUL terminating the buffer, so once a token has started,
+/// lookahead of one character past CurPtr is always safe.
+TOKEN Lexer::gettok() {
+  // Skip any whitespace. Most runs are a single space, so only hand longer
+  // runs such as indentation to the vector scanner.
+  if (CurPtr != End && isSpaceChar(*CurPtr) && ++CurPtr != End &&
+      isSpaceChar(*CurPtr))
+    CurPtr = Scanners.SkipSpace(CurPtr, End);
+
+  TokStart = CurPtr;
+
+  // Check for end of input.  Don't eat the EOF.
+  if (CurPtr == End)
+    return returnTok(EOF_TOK);
+
+  int LastChar = (unsigned char)*CurPtr;
 
   if (isalpha(LastChar) ||
       (LastChar == '_')) { // identifier: [a-zA-Z_][a-zA-Z_0-9]*
-    IdentifierStr = LastChar;
-    columnNo++;
-
-    while (isalnum((LastChar = getc(pFile))) || (LastChar == '_')) {
-      IdentifierStr += LastChar;
-      columnNo++;
-    }
-
-    if (IdentifierStr == "int")
-      return returnTok("int", INT_TOK);
-    if (IdentifierStr == "bool")
-      return returnTok("bool", BOOL_TOK);
-    if (IdentifierStr == "float")
-      return returnTok("float", FLOAT_TOK);
-    if (IdentifierStr == "void")
-      return returnTok("void", VOID_TOK);
-    if (IdentifierStr == "bool")
-      return returnTok("bool", BOOL_TOK);
-    if (IdentifierStr == "extern")
-      return returnTok("extern", EXTERN);
-    if (IdentifierStr == "if")
-      return returnTok("if", IF);
-    if (IdentifierStr == "else")
-      return returnTok("else", ELSE);
-    if (IdentifierStr == "while")
-      return returnTok("while", WHILE);
-    if (IdentifierStr == "return")
-      return returnTok("return", RETURN);
-    if (IdentifierStr == "true") {
-      BoolVal = true;
-      return returnTok("true", BOOL_LIT);
-    }
-    if (IdentifierStr == "false") {
-      BoolVal = false;
-      return returnTok("false", BOOL_LIT);
-    }
-
-    return returnTok(IdentifierStr.c_str(), IDENT);
+    CurPtr = Scanners.SkipIdent(CurPtr + 1, End);
+    StringRef IdentifierStr(TokStart, CurPtr - TokStart);
+
+    int Type = lookupKeyword(IdentifierStr);
+    if (Type != IDENT)
+      return returnTok(Type);
+
+    TOKEN Ident = returnTok(IDENT);
+    Ident.symbol = internIdentifier(IdentifierStr);
+    return Ident;
   }
 
   if (LastChar == '=') {
-    NextChar = getc(pFile);
-    if (NextChar == '=') { // EQ: ==
-      LastChar = getc(pFile);
-      columnNo += 2;
-      return returnTok("==", EQ);
+    if (CurPtr[1] == '=') { // EQ: ==
+      CurPtr += 2;
+      return returnTok(EQ);
     } else {
-      LastChar = NextChar;
-      columnNo++;
-      return returnTok("=", ASSIGN);
+      CurPtr++;
+      return returnTok(ASSIGN);
     }
   }
 
   if (LastChar == '{') {
-    LastChar = getc(pFile);
-    columnNo++;
-    return returnTok("{", LBRA);
+    CurPtr++;
+    return returnTok(LBRA);
   }
   if (LastChar == '}') {
-    LastChar = getc(pFile);
-    columnNo++;
-    return returnTok("}", RBRA);
+    CurPtr++;
+    return returnTok(RBRA);
   }
   if (LastChar == '(') {
-    LastChar = getc(pFile);
-    columnNo++;
-    return returnTok("(", LPAR);
+    CurPtr++;
+    return returnTok(LPAR);
   }
   if (LastChar == ')') {
-    LastChar = getc(pFile);
-    columnNo++;
-    return returnTok(")", RPAR);
+    CurPtr++;
+    return returnTok(RPAR);
   }
   if (LastChar == ';') {
-    LastChar = getc(pFile);
-    columnNo++;
-    return returnTok(";", SC);
+    CurPtr++;
+    return returnTok(SC);
   }
   if (LastChar == ',') {
-    LastChar = getc(pFile);
-    columnNo++;
-    return returnTok(",", COMMA);
+    CurPtr++;
+    return returnTok(COMMA);
   }
 
   if (isdigit(LastChar) || LastChar == '.') { // Number: [0-9]+.
-    std::string NumStr;
+    CurPtr = Scanners.SkipDigits(CurPtr, End); // Start of Number: [0-9]+
 
-    if (LastChar == '.') { // Floatingpoint Number: .[0-9]+
-      do {
-        NumStr += LastChar;
-        LastChar = getc(pFile);
-        columnNo++;
-      } while (isdigit(LastChar));
+    if (*CurPtr == '.') { // Floatingpoint Number: [0-9]*.[0-9]+
+      CurPtr = Scanners.SkipDigits(CurPtr + 1, End);
 
-      FloatVal = strtof(NumStr.c_str(), nullptr);
-      return returnTok(NumStr, FLOAT_LIT);
-    } else {
-      do { // Start of Number: [0-9]+
-        NumStr += LastChar;
-        LastChar = getc(pFile);
-        columnNo++;
-      } while (isdigit(LastChar));
-
-      if (LastChar == '.') { // Floatingpoint Number: [0-9]+.[0-9]+)
-        do {
-          NumStr += LastChar;
-          LastChar = getc(pFile);
-          columnNo++;
-        } while (isdigit(LastChar));
-
-        FloatVal = strtof(NumStr.c_str(), nullptr);
-        return returnTok(NumStr, FLOAT_LIT);
-      } else { // Integer : [0-9]+
-        IntVal = strtod(NumStr.c_str(), nullptr);
-        return returnTok(NumStr, INT_LIT);
-      }
+      return returnTok(FLOAT_LIT);
+    } else { // Integer : [0-9]+
+      return returnTok(INT_LIT);
     }
   }
 
   if (LastChar == '&') {
-    NextChar = getc(pFile);
-    if (NextChar == '&') { // AND: &&
-      LastChar = getc(pFile);
-      columnNo += 2;
-      return returnTok("&&", AND);
+    if (CurPtr[1] == '&') { // AND: &&
+      CurPtr += 2;
+      return returnTok(AND);
     } else {
-      LastChar = NextChar;
-      columnNo++;
-      return returnTok("&", int('&'));
+      CurPtr++;
+      return returnTok(int('&'));
     }
   }
 
   if (LastChar == '|') {
-    NextChar = getc(pFile);
-    if (NextChar == '|') { // OR: ||
-      LastChar = getc(pFile);
-      columnNo += 2;
-      return returnTok("||", OR);
+    if (CurPtr[1] == '|') { // OR: ||
+      CurPtr += 2;
+      return returnTok(OR);
     } else {
-      LastChar = NextChar;
-      columnNo++;
-      return returnTok("|", int('|'));
+      CurPtr++;
+      return returnTok(int('|'));
     }
   }
 
   if (LastChar == '!') {
-    NextChar = getc(pFile);
-    if (NextChar == '=') { // NE: !=
-      LastChar = getc(pFile);
-      columnNo += 2;
-      return returnTok("!=", NE);
+    if (CurPtr[1] == '=') { // NE: !=
+      CurPtr += 2;
+      return returnTok(NE);
     } else {
-      LastChar = NextChar;
-      columnNo++;
-      return returnTok("!", NOT);
-      ;
+      CurPtr++;
+      return returnTok(NOT);
     }
   }
 
   if (LastChar == '<') {
-    NextChar = getc(pFile);
-    if (NextChar == '=') { // LE: <=
-      LastChar = getc(pFile);
-      columnNo += 2;
-      return returnTok("<=", LE);
+    if (CurPtr[1] == '=') { // LE: <=
+      CurPtr += 2;
+      return returnTok(LE);
     } else {
-      LastChar = NextChar;
-      columnNo++;
-      return returnTok("<", LT);
+      CurPtr++;
+      return returnTok(LT);
     }
   }
 
   if (LastChar == '>') {
-    NextChar = getc(pFile);
-    if (NextChar == '=') { // GE: >=
-      LastChar = getc(pFile);
-      columnNo += 2;
-      return returnTok(">=", GE);
+    if (CurPtr[1] == '=') { // GE: >=
+      CurPtr += 2;
+      return returnTok(GE);
     } else {
-      LastChar = NextChar;
-      columnNo++;
-      return returnTok(">", GT);
+      CurPtr++;
+      return returnTok(GT);
     }
   }
 
   if (LastChar == '/') { // could be division or could be the start of a comment
-    LastChar = getc(pFile);
-    columnNo++;
-    if (LastChar == '/') { // definitely a comment
-      do {
-        LastChar = getc(pFile);
-        columnNo++;
-      } while (LastChar != EOF && LastChar != '\n' && LastChar != '\r');
+    if (CurPtr[1] == '/') { // definitely a comment
+      CurPtr = Scanners.SkipToLineEnd(CurPtr + 2, End);
+      return gettok();
+    }
+    CurPtr++;
+    return returnTok(DIV);
+  }
+
+  // Otherwise, just return the character as its ascii value.
+  CurPtr++;
+  return returnTok(LastChar);
+}
+
+/// lexAll - Lex the whole source range into Stream, ending with EOF_TOK.
+void Lexer::lexAll(TokenStream &Stream) {
+  // Generated MiniC averages around eight bytes per token.
+  Stream.reserve((End - CurPtr) / 8);
+  TOKEN Tok;
+  do {
+    Tok = gettok();
+    Stream.push_back(Tok);
+  } while (Tok.type != EOF_TOK);
+}
+
+/// ParallelLexOptions - When lexParallel splits a buffer, and how widely.
+struct ParallelLexOptions {
+  // Buffers smaller than this are lexed serially; below it the thread
+  // start-up costs more than the lexing. Chunks are at least a quarter of it.
+  size_t Threshold = 4 << 20;
+  unsigned Threads = 0; // 0: one per hardware thread
+};
 
-      if (LastChar != EOF)
-        return gettok();
-    } else
-      return returnTok("/", DIV);
+/// lexParallel - Lex Source into Stream, splitting large buffers into chunks
+/// that are lexed on a thread pool. MiniC has only line comments and no string
+/// literals, so every newline is a token boundary and chunks are split just
+/// after one. Each chunk interns its identifiers into a private table; the
+/// chunks are then stitched together in order, interning each chunk's names
+/// into Symbols in first-seen order, so the resulting stream and symbol ids
+/// are exactly those of a serial lex. Line numbers need no fixing up because
+/// tokens record buffer offsets and lines are only computed for diagnostics.
+static void lexParallel(const SourceBuffer &Source, TokenStream &Stream,
+                        StringInterner &Symbols,
+                        const ParallelLexOptions &Opts) {
+  unsigned Threads = Opts.Threads
+                         ? Opts.Threads
+                         : llvm::hardware_concurrency().compute_thread_count();
+  size_t MinChunkSize = std::max<size_t>(Opts.Threshold / 4, 1);
+  size_t NumChunks = std::min<size_t>(Threads, Source.size() / MinChunkSize);
+  if (Source.size() < Opts.Threshold || NumChunks < 2) {
+    Lexer(Source, Symbols).lexAll(Stream);
+    return;
+  }
+
+  std::vector<const char *> Bounds{Source.begin()};
+  size_t ChunkSize = Source.size() / NumChunks;
+  for (size_t i = 1; i != NumChunks; ++i) {
+    const char *Split = Bounds.back() + ChunkSize;
+    if (Split >= Source.end())
+      break;
+    Split = static_cast<const char *>(
+        memchr(Split, '\n', Source.end() - Split));
+    if (!Split)
+      break;
+    Bounds.push_back(Split + 1);
   }
+  Bounds.push_back(Source.end());
+  NumChunks = Bounds.size() - 1;
 
-  // Check for end of file.  Don't eat the EOF.
-  if (LastChar == EOF) {
-    columnNo++;
-    return returnTok("0", EOF_TOK);
+  std::vector<TokenStream> Chunks(NumChunks);
+  std::vector<StringInterner> ChunkSymbols(NumChunks);
+  {
+    ThreadPool Pool(llvm::hardware_concurrency(NumChunks));
+    for (size_t i = 0; i != NumChunks; ++i)
+      Pool.async([&, i] {
+        Lexer(Source, Bounds[i], Bounds[i + 1], ChunkSymbols[i])
+            .lexAll(Chunks[i]);
+      });
+    Pool.wait();
+  }
+
+  size_t Total = 1;
+  for (const TokenStream &Chunk : Chunks)
+    Total += Chunk.size() - 1;
+  Stream.reserve(Total);
+
+  // Every chunk but the last ends in an EOF_TOK at its split point, which is
+  // dropped once the chunk has been appended.
+  std::vector<unsigned> SymbolMap;
+  for (size_t i = 0; i != NumChunks; ++i) {
+    SymbolMap.resize(ChunkSymbols[i].size());
+    for (unsigned Id = 0, e = SymbolMap.size(); Id != e; ++Id)
+      SymbolMap[Id] = Symbols.intern(ChunkSymbols[i].getName(Id));
+    Stream.append(Chunks[i], SymbolMap);
+    if (i + 1 != NumChunks)
+      Stream.pop_back();
   }
+}
 
-  // Otherwise, just return the character as its ascii value.
-  int ThisChar = LastChar;
-  std::string s(1, ThisChar);
-  LastChar = getc(pFile);
-  columnNo++;
-  return returnTok(s, int(ThisChar));
+//===----------------------------------------------------------------------===//
+// Binary operators
+//===----------------------------------------------------------------------===//
+
+/// BinOp - A binary operator, decoded from its token once by the parser so
+/// that later passes index tables by it instead of comparing spellings.
+enum class BinOp : uint8_t {
+  Or, And, EQ, NE, LE, LT, GE, GT, Add, Sub, Mul, Div, Rem,
+};
+
+static constexpr unsigned NumBinOps = unsigned(BinOp::Rem) + 1;
+
+static const char *getBinOpSpelling(BinOp Op) {
+  static const char *const Spellings[NumBinOps] = {
+      "||", "&&", "==", "!=", "<=", "<", ">=", ">", "+", "-", "*", "/", "%"};
+  return Spellings[unsigned(Op)];
 }
 
 //===----------------------------------------------------------------------===//
-// Parser
+// Flat AST
 //===----------------------------------------------------------------------===//
 
-/// CurTok/getNextToken - Provide a simple token buffer.  CurTok is the current
-/// token the parser is looking at.  getNextToken reads another token from the
-/// lexer and updates CurTok with its results.
-static TOKEN CurTok;
-static std::deque<TOKEN> tok_buffer;
+/// NodeKind - The kinds of node in a FlatAST. The comment on each kind says
+/// what its Tag and operands hold; "list" operands index FlatAST::Lists.
+enum class NodeKind : uint8_t {
+  IntLit,   // A: value
+  FloatLit, // A: bit pattern of the float value
+  BoolLit,  // A: value
+  Unary,    // Tag: '-' or '!', A: operand
+  Ident,    // A: symbol
+  Binary,   // Tag: BinOp, A: lhs, B: rhs
+  Call,     // A: callee symbol, B: first argument in list, C: argument count
+  Assign,   // A: symbol, B: value
+  Return,   // A: value or None
+  If,       // A: condition, B: then block, C: else block or None
+  While,    // A: condition, B: body
+  Block,    // A: first entry in list, B: declaration count, C: statement count
+  VarDecl,  // Tag: type token, A: symbol
+  Param,    // Tag: type token, A: symbol (0 for a void parameter list)
+  Extern,   // Tag: return type token, A: symbol, B: first param, C: count
+  Function, // A: prototype (an Extern), B: body block
+  Program,  // A: first entry in list, B: extern count, C: declaration count
+};
+
+/// FlatNode - One node of a FlatAST: sixteen bytes, no pointers, no vtable.
+struct FlatNode {
+  NodeKind Kind;
+  int16_t Tag;
+  uint32_t A, B, C;
+};
 
-static TOKEN getNextToken() {
+/// FlatAST - A compact, data oriented copy of the AST. Nodes sit in one
+/// contiguous array and refer to each other by 32-bit index; variable length
+/// child lists live in a second array. Children are always added before their
+/// parent, so the root is the last node. Passes over it are plain switches on
+/// NodeKind rather than virtual calls.
+struct FlatAST {
+  static constexpr uint32_t None = ~0u;
 
-  if (tok_buffer.size() == 0)
-    tok_buffer.push_back(gettok());
+  std::vector<FlatNode> Nodes;
+  std::vector<uint32_t> Lists;
 
-  TOKEN temp = tok_buffer.front();
-  tok_buffer.pop_front();
+  uint32_t add(NodeKind Kind, int Tag = 0, uint32_t A = 0, uint32_t B = 0,
+               uint32_t C = 0) {
+    Nodes.push_back({Kind, static_cast<int16_t>(Tag), A, B, C});
+    return Nodes.size() - 1;
+  }
 
-  return CurTok = temp;
-}
+  uint32_t addList(ArrayRef<uint32_t> Ids) {
+    uint32_t First = Lists.size();
+    Lists.insert(Lists.end(), Ids.begin(), Ids.end());
+    return First;
+  }
 
+  uint32_t getRoot() const { return Nodes.empty() ? None : Nodes.size() - 1; }
+  const FlatNode &operator[](uint32_t Id) const { return Nodes[Id]; }
+  ArrayRef<uint32_t> getList(uint32_t First, uint32_t Count) const {
+    return makeArrayRef(Lists).slice(First, Count);
+  }
+};
 
+/// ASTSummary - Counts gathered by the summarize passes. Both AST forms must
+/// produce the same summary for the same program.
+struct ASTSummary {
+  uint64_t Nodes = 0;
+  uint64_t Literals = 0;
+  uint64_t References = 0; // Identifier reads and assignments
+  uint64_t Calls = 0;
+  uint64_t Scopes = 0;     // Blocks
 
-static void putBackToken(TOKEN tok) { tok_buffer.push_front(tok); }
+  bool operator==(const ASTSummary &O) const {
+    return Nodes == O.Nodes && Literals == O.Literals &&
+           References == O.References && Calls == O.Calls && Scopes == O.Scopes;
+  }
+};
 
 //===----------------------------------------------------------------------===//
 // AST nodes
 //===----------------------------------------------------------------------===//
 
-/// ASTnode - Base class for all AST nodes.
+/// ASTContext - Owns every node of one translation unit. Nodes and child lists
+/// are bump allocated and released all at once when the context goes away, so
+/// parsing costs one pointer bump per node and teardown is a handful of slab
+/// frees.
+class ASTContext {
+  BumpPtrAllocator Allocator;
+
+public:
+  template <typename T, typename... ArgTys> T *create(ArgTys &&... Args) {
+    static_assert(std::is_trivially_destructible<T>::value,
+                  "AST nodes are never destroyed");
+    return new (Allocator.Allocate<T>()) T(std::forward<ArgTys>(Args)...);
+  }
+
+  /// copy - Move a list of children built up by the parser into the arena.
+  /// Passes that rewrite the tree may replace or drop elements in place.
+  template <typename T> MutableArrayRef<T> copy(const std::vector<T> &Elts) {
+    if (Elts.empty())
+      return None;
+    T *Mem = Allocator.Allocate<T>(Elts.size());
+    std::uninitialized_copy(Elts.begin(), Elts.end(), Mem);
+    return MutableArrayRef<T>(Mem, Elts.size());
+  }
+};
+
+/// MiniCType - The type of a MiniC expression or declaration. Invalid marks
+/// an expression Sema has already reported, so one mistake is diagnosed once.
+enum class MiniCType : uint8_t { Int, Float, Bool, Void, Invalid };
+
+/// Conversion - An implicit conversion Sema attaches to an expression, applied
+/// by codegen when the expression's value is used.
+enum class Conversion : uint8_t {
+  None,
+  IntToFloat, // int widened to float
+};
+
+/// NoSlot - The slot of a variable that is not a function local.
+static constexpr unsigned NoSlot = ~0u;
+
+/// AnyReg - The bytecode register given to an expression that may leave its
+/// value wherever is cheapest, such as in the local variable it reads.
+static constexpr unsigned AnyReg = ~0u;
+
+/// NotSpeculatable - The speculation cost of an expression that may have side
+/// effects or trap, and so must only be evaluated when the program says so.
+static constexpr unsigned NotSpeculatable = ~0u;
+
+static MiniCType getMiniCType(int TokType) {
+  switch (TokType) {
+  case INT_TOK:
+    return MiniCType::Int;
+  case FLOAT_TOK:
+    return MiniCType::Float;
+  case BOOL_TOK:
+    return MiniCType::Bool;
+  default:
+    return MiniCType::Void;
+  }
+}
+
+static const char *getTypeName(MiniCType Ty) {
+  switch (Ty) {
+  case MiniCType::Int:
+    return "int";
+  case MiniCType::Float:
+    return "float";
+  case MiniCType::Bool:
+    return "bool";
+  case MiniCType::Void:
+    return "void";
+  case MiniCType::Invalid:
+    break;
+  }
+  return "<invalid>";
+}
+
+/// ConstantValue - The value of a constant MiniC expression, as found by the
+/// constant folder. Only the field for Ty is meaningful.
+struct ConstantValue {
+  MiniCType Ty;
+  int Int = 0;
+  float Float = 0;
+  bool Bool = false;
+
+  static ConstantValue getInt(int V) {
+    ConstantValue C{MiniCType::Int};
+    C.Int = V;
+    return C;
+  }
+  static ConstantValue getFloat(float V) {
+    ConstantValue C{MiniCType::Float};
+    C.Float = V;
+    return C;
+  }
+  static ConstantValue getBool(bool V) {
+    ConstantValue C{MiniCType::Bool};
+    C.Bool = V;
+    return C;
+  }
+};
+
+class ASTDumper;
+class Sema;
+class ASTFolder;
+class BytecodeCompiler;
+
+/// ASTnode - Base class for all AST nodes. Nodes live in an ASTContext and are
+/// never destroyed one at a time, so they hold only trivially destructible
+/// members: child pointers, ArrayRefs into the arena, tokens and scalars.
 class ASTnode {
+protected:
+  MiniCType Ty = MiniCType::Void;     // Set by analyze() on expressions
+  Conversion Conv = Conversion::None; // Set by Sema on the expression's user
+
 public:
-  virtual ~ASTnode() {}
   virtual Value *codegen() = 0;
-  virtual std::string to_string() const {
-    std::cout << "AST NODE";
-    return "";
-  };
+  virtual void analyze(Sema &S) = 0;
+  /// fold - Fold constants below this node and return the node to use in its
+  /// place: this, a literal, or for a statement a simpler statement or null.
+  virtual ASTnode *fold(ASTFolder &F) = 0;
+  /// compile - Compile the node to bytecode. An expression leaves its value
+  /// in register Dst, or if Dst is AnyReg in one of its choosing, and returns
+  /// the register; a statement returns AnyReg.
+  virtual unsigned compile(BytecodeCompiler &C, unsigned Dst) = 0;
+  /// compileBranch - Compile a jump taken if this condition is WhenTrue, and
+  /// return it for its target to be set.
+  virtual unsigned compileBranch(BytecodeCompiler &C, bool WhenTrue);
+  virtual uint32_t flatten(FlatAST &F) const = 0;
+  virtual void summarize(ASTSummary &S) const = 0;
+  virtual void dump(ASTDumper &D) const = 0;
+
+  MiniCType getExprType() const { return Ty; }
+  Conversion getConversion() const { return Conv; }
+  void setConversion(Conversion C) { Conv = C; }
+
+  /// getConstant - The value of a literal.
+  virtual Optional<ConstantValue> getConstant() const { return None; }
+
+  /// getSpeculationCost - Roughly how many instructions evaluating the
+  /// expression takes, or NotSpeculatable.
+  virtual unsigned getSpeculationCost() const { return NotSpeculatable; }
 };
 
 /// IntASTnode - Class for integer literals like 1, 2, 10,
 class IntASTnode : public ASTnode {
   int Val;
-  TOKEN Tok;
-  std::string Name;
 
 public:
-  IntASTnode(TOKEN tok, int val) : Val(val), Tok(tok) {}
+  IntASTnode(int val) : Val(val) { Ty = MiniCType::Int; }
   virtual Value *codegen() override;
-  virtual std::string to_string() const override {
-    return std::to_string(Val);
-  }
+  virtual void analyze(Sema &S) override;
+  virtual ASTnode *fold(ASTFolder &F) override;
+  virtual unsigned compile(BytecodeCompiler &C, unsigned Dst) override;
+  virtual uint32_t flatten(FlatAST &F) const override;
+  virtual void summarize(ASTSummary &S) const override;
+  virtual Optional<ConstantValue> getConstant() const override {
+    return ConstantValue::getInt(Val);
+  }
+  virtual unsigned getSpeculationCost() const override { return 0; }
+  virtual void dump(ASTDumper &D) const override;
 };
 
 class floatASTnode : public ASTnode {
   float Val;
-  TOKEN Tok;
-  std::string Name;
 
 public:
-  floatASTnode(TOKEN tok, float val) : Val(val), Tok(tok) {}
+  floatASTnode(float val) : Val(val) { Ty = MiniCType::Float; }
   virtual Value *codegen() override;
-  virtual std::string to_string() const override {
-    return std::to_string(Val);
-  }
+  virtual void analyze(Sema &S) override;
+  virtual ASTnode *fold(ASTFolder &F) override;
+  virtual unsigned compile(BytecodeCompiler &C, unsigned Dst) override;
+  virtual uint32_t flatten(FlatAST &F) const override;
+  virtual void summarize(ASTSummary &S) const override;
+  virtual Optional<ConstantValue> getConstant() const override {
+    return ConstantValue::getFloat(Val);
+  }
+  virtual unsigned getSpeculationCost() const override { return 0; }
+  virtual void dump(ASTDumper &D) const override;
 };
 
 
 class boolASTnode : public ASTnode {
   bool Val;
-  TOKEN Tok;
-  std::string Name;
 
 public:
-  boolASTnode(TOKEN tok, bool val) : Val(val), Tok(tok) {}
+  boolASTnode(bool val) : Val(val) { Ty = MiniCType::Bool; }
   virtual Value *codegen() override;
-  virtual std::string to_string() const override {
-    return std::to_string(Val);
-  }
+  virtual void analyze(Sema &S) override;
+  virtual ASTnode *fold(ASTFolder &F) override;
+  virtual unsigned compile(BytecodeCompiler &C, unsigned Dst) override;
+  virtual uint32_t flatten(FlatAST &F) const override;
+  virtual void summarize(ASTSummary &S) const override;
+  virtual Optional<ConstantValue> getConstant() const override {
+    return ConstantValue::getBool(Val);
+  }
+  virtual unsigned getSpeculationCost() const override { return 0; }
+  virtual void dump(ASTDumper &D) const override;
 };
 
 class notAndNegativeASTnode : public ASTnode {
   char prefix;
   TOKEN token;
-  std::string name;
-  std::unique_ptr<ASTnode> expression;
+  ASTnode *expression;
 public:
-  notAndNegativeASTnode(char Prefix, TOKEN Token, std::unique_ptr<ASTnode> Expression) : prefix(Prefix), token(Token), expression(std::move(Expression)) {}
+  notAndNegativeASTnode(char Prefix, TOKEN Token, ASTnode *Expression) : prefix(Prefix), token(Token), expression(Expression) {}
   virtual Value *codegen() override;
-  virtual std::string to_string() const override {
-    return "prefix: " + std::string(1, prefix) + " name: " + expression->to_string();
-  }
+  virtual void analyze(Sema &S) override;
+  virtual ASTnode *fold(ASTFolder &F) override;
+  virtual unsigned compile(BytecodeCompiler &C, unsigned Dst) override;
+  virtual uint32_t flatten(FlatAST &F) const override;
+  virtual void summarize(ASTSummary &S) const override;
+  virtual void dump(ASTDumper &D) const override;
+  virtual unsigned getSpeculationCost() const override;
 };
 
 class typeASTnode : public ASTnode{
@@ -485,32 +1161,15 @@ public:
   virtual Value *codegen() override {
     return nullptr;
   };
-  virtual std::string to_string() const override{
-    std::string returner = "";
-    switch (token.type)
-    {
-    case INT_TOK:
-      returner = returner + "'INT'";
-      break;
-    case BOOL_TOK:
-      returner = returner + "'BOOL'";
-      break;
-    case FLOAT_TOK:
-      returner = returner + "'FLOAT'";
-      break;
-    case VOID_TOK:
-      returner = returner + "'VOID'";
-      break;
-    default:
-      break;
-    }
-    returner = returner;
-    return returner;
-  };
-
-  std::string typereturn(){
-    return token.lexeme.c_str();
+  virtual void analyze(Sema &S) override {}
+  virtual ASTnode *fold(ASTFolder &F) override { return this; }
+  virtual unsigned compile(BytecodeCompiler &C, unsigned Dst) override {
+    return AnyReg;
   }
+  // Types are folded into the declaration that uses them.
+  virtual uint32_t flatten(FlatAST &F) const override { return FlatAST::None; }
+  virtual void summarize(ASTSummary &S) const override {}
+  virtual void dump(ASTDumper &D) const override;
 
   TOKEN getToken(){
     return token;
@@ -523,247 +1182,153 @@ public:
 };
 
 class returnASTnode : public ASTnode {
-  std::unique_ptr<ASTnode> expression;
-  std::unique_ptr<ASTnode> semiColon;
+  ASTnode *expression = nullptr; // Null for a bare return
 public:
-  returnASTnode(std::unique_ptr<ASTnode> Expression) : expression(std::move(Expression)){}
+  returnASTnode(ASTnode *Expression) : expression(Expression){}
   returnASTnode(){}
 
   virtual Value *codegen() override;
-  virtual std::string to_string() const override {
-    std::string stringy = "";
-    for (size_t i = 0; i < indentation; i++)
-    {
-      if(i == 0) stringy += indent;
-      else stringy = stringy + "|      ";
-    }
-    stringy += "├──Return Statement:\n";
-    if(expression){
-      indentation++;
-      for (size_t i = 0; i < indentation; i++)
-      {
-        if(i == 0) stringy += indent;
-        else stringy = stringy + "|      ";
-      }
-      stringy = stringy + "├──Expression: " + expression->to_string().c_str() + "\n";
-      indentation--;
-    }
-    return stringy;
-  }
+  virtual void analyze(Sema &S) override;
+  virtual ASTnode *fold(ASTFolder &F) override;
+  virtual unsigned compile(BytecodeCompiler &C, unsigned Dst) override;
+  virtual uint32_t flatten(FlatAST &F) const override;
+  virtual void summarize(ASTSummary &S) const override;
+  virtual void dump(ASTDumper &D) const override;
 };
 
 
 class identASTnode : public ASTnode {
   TOKEN token;
-  std::string value;
+  StringRef Name;         // Owned by the translation unit's StringInterner
+  unsigned Slot = NoSlot; // Bound by Sema
 
 public:
-  identASTnode(TOKEN Token, std::string Value) : token(Token), value(Value) {}
+  identASTnode(TOKEN Token, StringRef Name) : token(Token), Name(Name) {}
   virtual Value *codegen() override;
-  virtual std::string to_string() const override{
-    return value;
+  virtual void analyze(Sema &S) override;
+  virtual ASTnode *fold(ASTFolder &F) override;
+  virtual unsigned compile(BytecodeCompiler &C, unsigned Dst) override;
+  virtual uint32_t flatten(FlatAST &F) const override;
+  virtual void summarize(ASTSummary &S) const override;
+  virtual void dump(ASTDumper &D) const override;
+  virtual unsigned getSpeculationCost() const override { return 1; } // A load
+  StringRef getName() const {
+    return Name;
+  }
+  unsigned getSymbol() const {
+    return token.symbol;
   }
   TOKEN getToken(){
     return token;
   }
+  unsigned getSlot() const {
+    return Slot;
+  }
+  void bindSlot(unsigned S) {
+    Slot = S;
+  }
 };
 
 
 class globalASTnode : public ASTnode {
-  std::unique_ptr<typeASTnode> type;
-  std::unique_ptr<identASTnode> ident;
+  typeASTnode *type;
+  identASTnode *ident;
+  unsigned Slot = NoSlot; // Assigned by Sema
+  bool Propagated = false; // Every use replaced by its constant value
 public:
-  globalASTnode(std::unique_ptr<typeASTnode> Type, std::unique_ptr<identASTnode> Ident)
-  : type(std::move(Type)), ident(std::move(Ident)) {}
+  globalASTnode(typeASTnode *Type, identASTnode *Ident)
+  : type(Type), ident(Ident) {}
   virtual Value *codegen() override;
+  virtual void analyze(Sema &S) override;
+  virtual ASTnode *fold(ASTFolder &F) override;
+  virtual unsigned compile(BytecodeCompiler &C, unsigned Dst) override;
+  virtual uint32_t flatten(FlatAST &F) const override;
+  virtual void summarize(ASTSummary &S) const override;
   int getType() const {
     return type->getType();
   }
-  std::string get_name(){
-    return ident->to_string();
+  StringRef get_name() const {
+    return ident->getName();
   }
-  virtual std::string to_string() const override{
-    std::string stringy = "";
-    for (size_t i = 0; i < indentation; i++)
-    {
-      if(i == 0) stringy += indent;
-      else stringy = stringy + "|      ";
-    }
-    stringy += "├──Variable declared:" +  ident->to_string() + "\n";;
-    for (size_t i = 0; i < indentation; i++)
-    {
-      if(i == 0) stringy += indent;
-      else stringy = stringy + "|      ";
-    }
-    stringy += "|  Type: " + type->typereturn();
-    return stringy;
+  unsigned get_symbol(){
+    return ident->getSymbol();
+  }
+  unsigned getSlot() const {
+    return Slot;
+  }
+  bool isPropagated() const {
+    return Propagated;
   }
+  void setPropagated(bool P) {
+    Propagated = P;
+  }
+  virtual void dump(ASTDumper &D) const override;
 };
 
 
 class BlockASTnode : public ASTnode {
-  std::vector<std::unique_ptr<globalASTnode>> declarations;
-  std::vector<std::unique_ptr<ASTnode>> statements;
+  ArrayRef<globalASTnode *> declarations;
+  MutableArrayRef<ASTnode *> statements;
 
 public:
-  BlockASTnode(std::vector<std::unique_ptr<globalASTnode>> newDeclarations, std::vector<std::unique_ptr<ASTnode>> newStatements) :
-  declarations(std::move(newDeclarations)), statements(std::move(newStatements)){}
+  BlockASTnode(ArrayRef<globalASTnode *> newDeclarations, MutableArrayRef<ASTnode *> newStatements) :
+  declarations(newDeclarations), statements(newStatements){}
   virtual Value *codegen() override;
-  virtual std::string to_string() const override {    
-    std::string tostring = "";
-    if(declarations.size() >= 1){
-      tostring += "\n";
-      for (size_t i = 0; i < indentation; i++)
-      {
-        if(i == 0) tostring += indent;
-        else tostring = tostring + "|      ";
-      }
-      tostring += "├──";
-      tostring = tostring + "Declarations of local variables: \n";
-      indentation++;
-      for (size_t i = 0; i < declarations.size(); i++)
-      {
-        tostring = tostring + std::string(declarations.at(i)->to_string().c_str()) + "\n";
-      }
-      indentation--;
-    }
-    if(statements.size() >= 1){
-      for (size_t i = 0; i < indentation; i++)
-      {
-        if(i == 0) tostring += indent;
-        else tostring = tostring + "|      ";
-      }
-      tostring += "├──";
-      tostring = tostring + "Statements: \n";
-      indentation++;
-      for (size_t i = 0; i < statements.size(); i++)
-      {
-        tostring = tostring + "" + std::string(statements.at(i)->to_string().c_str());
-        //if(exprbool) tostring+="HELLO\n";
-      }
-      indentation--;
-    }
-    return tostring;
-  }
+  virtual void analyze(Sema &S) override;
+  virtual ASTnode *fold(ASTFolder &F) override;
+  virtual unsigned compile(BytecodeCompiler &C, unsigned Dst) override;
+  virtual uint32_t flatten(FlatAST &F) const override;
+  virtual void summarize(ASTSummary &S) const override;
+  virtual void dump(ASTDumper &D) const override;
 };
 
 class ifASTnode : public ASTnode{
-  std::unique_ptr<ASTnode> expr;
-  std::unique_ptr<BlockASTnode> block;
-  std::unique_ptr<BlockASTnode> elseBlock;
+  ASTnode *expr;
+  BlockASTnode *block;
+  BlockASTnode *elseBlock;
 
 public:
-  ifASTnode(std::unique_ptr<ASTnode> Expr, std::unique_ptr<BlockASTnode> Block, std::unique_ptr<BlockASTnode> ElseBlock) : expr(std::move(Expr)), block(std::move(Block)), elseBlock(std::move(ElseBlock)) {}
+  ifASTnode(ASTnode *Expr, BlockASTnode *Block, BlockASTnode *ElseBlock) : expr(Expr), block(Block), elseBlock(ElseBlock) {}
   virtual Value *codegen() override;
-  virtual std::string to_string() const override {
-    std::string stringy ="";
-    for (size_t i = 0; i < indentation; i++)
-    {
-      if(i == 0) stringy += indent ;
-      else stringy = stringy + "|      ";
-    }
-    stringy += "├──If statement:\n";
-    indentation++;
-    for (size_t i = 0; i < indentation; i++)
-    {
-      if(i == 0) stringy += indent ;
-      else stringy = stringy + "|      ";
-    }
-    lineneeded = true;
-    usestart = false;
-    stringy = stringy +   "├──Condition: " + expr->to_string();
-    usestart = true;
-    stringy += "\n";
-
-    for (size_t i = 0; i < indentation; i++)
-    {
-      if(i == 0) stringy += indent ;
-      else stringy = stringy + "|      ";
-    }
-    stringy = stringy +   "├──Block: \n";
-    lineneeded = false;
-    indentation++;
-    stringy += block->to_string();
-    indentation--;
-    for (size_t i = 0; i < indentation; i++)
-    {
-      if(i == 0) stringy += indent ;
-      else stringy = stringy + "|      ";
-    }
-    if(elseBlock){
-      stringy = stringy + "├──Else block: \n";
-      indentation++;
-      stringy += elseBlock->to_string();
-      indentation--;
-    }
-    indentation--;
-    return stringy;
-  }
+  virtual void analyze(Sema &S) override;
+  virtual ASTnode *fold(ASTFolder &F) override;
+  virtual unsigned compile(BytecodeCompiler &C, unsigned Dst) override;
+  virtual uint32_t flatten(FlatAST &F) const override;
+  virtual void summarize(ASTSummary &S) const override;
+  virtual void dump(ASTDumper &D) const override;
 };
 
 
 
 class assignmentASTnode : public ASTnode {
-    std::unique_ptr<identASTnode> ident;
-    std::unique_ptr<ASTnode> expr;
+    identASTnode *ident;
+    ASTnode *expr;
 
 public:
-  assignmentASTnode(std::unique_ptr<identASTnode> Ident, std::unique_ptr<ASTnode> Expr) : ident(std::move(Ident)), expr(std::move(Expr)) {}
+  assignmentASTnode(identASTnode *Ident, ASTnode *Expr) : ident(Ident), expr(Expr) {}
   virtual Value *codegen() override;
+  virtual void analyze(Sema &S) override;
+  virtual ASTnode *fold(ASTFolder &F) override;
+  virtual unsigned compile(BytecodeCompiler &C, unsigned Dst) override;
+  virtual uint32_t flatten(FlatAST &F) const override;
+  virtual void summarize(ASTSummary &S) const override;
 
-  virtual std::string to_string() const override {
-    std::string stringy = "";
-    for (size_t i = 0; i < indentation; i++)
-    {
-      if(i == 0) stringy += indent;
-      else stringy = stringy + "|      ";
-    }
-    stringy += "├──Assignment: \n";
-    assign++;
-    indentation++;
-    for (size_t i = 0; i < indentation; i++)
-    {
-      if(i == 0) stringy += indent;
-      else stringy = stringy + "|      ";
-    }
-    stringy = stringy + "Name :" + ident->to_string() +"\n";
-    for (size_t i = 0; i < indentation; i++)
-    {
-      if(i == 0) stringy += indent;
-      else stringy = stringy + "|      ";
-    }
-    indentation++;
-    usestart = false;
-    stringy = stringy + "Value: " + expr->to_string();
-    usestart = true;
-    stringy += "\n";
-    lineneeded = true;
-    indentation--;
-    indentation--;
-    return  stringy;
-  }
+  virtual void dump(ASTDumper &D) const override;
 };
 
 class parameterASTnode : public ASTnode {
-  std::unique_ptr<typeASTnode> type;
-  std::unique_ptr<identASTnode> identifier;
+  typeASTnode *type;
+  identASTnode *identifier;
+  unsigned Slot = NoSlot; // Assigned by Sema to function parameters
 public:
-  parameterASTnode(std::unique_ptr<typeASTnode> Type, std::unique_ptr<identASTnode> Identifier) : type(std::move(Type)), identifier(std::move(Identifier)) {}
+  parameterASTnode(typeASTnode *Type, identASTnode *Identifier) : type(Type), identifier(Identifier) {}
   virtual Value *codegen() override;
-  virtual std::string to_string() const override {
-    std::string stringy = "";
-    stringy = stringy + "Variable: ";
-    if(identifier) stringy += identifier->to_string() +"\n";
-    else stringy += "void";
-    for (size_t i = 0; i < indentation; i++)
-    {
-      if(i == 0) stringy += indent;
-      else stringy = stringy + "|      ";
-    }
-    
-    stringy = stringy + "|  type: "  + type->to_string();
-    return stringy;
-  }
+  virtual void analyze(Sema &S) override;
+  virtual ASTnode *fold(ASTFolder &F) override;
+  virtual unsigned compile(BytecodeCompiler &C, unsigned Dst) override;
+  virtual uint32_t flatten(FlatAST &F) const override;
+  virtual void summarize(ASTSummary &S) const override;
+  virtual void dump(ASTDumper &D) const override;
   int getType(){
     return type->getType();
   }
@@ -773,234 +1338,135 @@ public:
   TOKEN getTokenOfIdent(){
     return identifier->getToken();
   }
-  std::string getName(){
-    return identifier->to_string();
+  StringRef getName() const {
+    return identifier->getName();
+  }
+  unsigned getSymbol(){
+    return identifier->getSymbol();
+  }
+  unsigned getSlot() const {
+    return Slot;
+  }
+  void bindSlot(unsigned S) {
+    Slot = S;
   }
 };
 
 class expressionASTnode : public ASTnode {
-  std::unique_ptr<ASTnode> left;
-  std::string operation;
-  std::unique_ptr<ASTnode> right;
+  ASTnode *left;
+  BinOp Op;
+  MiniCType OperandTy = MiniCType::Invalid; // Both operands, once converted
+  ASTnode *right;
 public:
-  expressionASTnode(std::unique_ptr<ASTnode> LEFT, TOKEN Operation, std::unique_ptr<ASTnode> RIGHT) 
-  : left(std::move(LEFT)), operation(Operation.lexeme), right(std::move(RIGHT)) {}
+  expressionASTnode(ASTnode *LEFT, BinOp Op, ASTnode *RIGHT)
+  : left(LEFT), Op(Op), right(RIGHT) {}
   virtual Value *codegen() override;
-  virtual std::string to_string() const override {
-    bool indentb = false;
-    exprbool = true;
-    if(isrhsorlhs){
-      indentation++;
-      indentb = true;
-    }
-    std::string stringy = "";
-    if(usestart){
-    for (size_t i = 0; i < indentation; i++)
-    {
-      if(i == 0) stringy += indent;
-      else stringy = stringy + "|      ";
-    }
-      stringy += "├──";
-    }
-    stringy += "Expression:\n";
-    usestart = true ;
-    indentation++;
-    for (size_t i = 0; i < indentation; i++)
-    {
-      if(i == 0) stringy += indent;
-      else stringy = stringy + "|      ";
-    }
-    isrhsorlhs = true;
-    usestart = false;
-    stringy += "├──Left hand side: " + left->to_string() +"\n";
-    usestart = true;
-    isrhsorlhs = false;
-    for (size_t i = 0; i < indentation; i++)
-    {
-      if(i == 0) stringy += indent;
-      else stringy = stringy + "|      ";
-    }
-    stringy += "├──Operator: " + operation +"\n";
-    for (size_t i = 0; i < indentation; i++)
-    {
-      if(i == 0) stringy += indent;
-      else stringy = stringy + "|      ";
-    }
-    isrhsorlhs = true;
-    inrhs++;
-    usestart = false;
-    stringy += "├──Right hand side: " + right->to_string();
-    usestart = true;
-    inrhs--;
-    lineneeded = false;
-    isrhsorlhs = false;
-    indentation--;
-    if(indentb == true){
-      indentation--;
-    }
-    return stringy;
-  }
+  virtual void analyze(Sema &S) override;
+  virtual ASTnode *fold(ASTFolder &F) override;
+  virtual unsigned compile(BytecodeCompiler &C, unsigned Dst) override;
+  virtual unsigned compileBranch(BytecodeCompiler &C, bool WhenTrue) override;
+  virtual uint32_t flatten(FlatAST &F) const override;
+  virtual void summarize(ASTSummary &S) const override;
+  virtual void dump(ASTDumper &D) const override;
+  virtual unsigned getSpeculationCost() const override;
 };
 
 class functionCall : public ASTnode {
-  std::unique_ptr<ASTnode> name;
-  std::vector<std::unique_ptr<ASTnode>> arguments;
-  std::string caller;
+  identASTnode *name;
+  MutableArrayRef<ASTnode *> arguments;
+  TOKEN caller;
 public:
-  functionCall(std::unique_ptr<ASTnode> Name, std::vector<std::unique_ptr<ASTnode>> Arguments, TOKEN token) : name(std::move(Name)), arguments(std::move(Arguments)), caller(token.lexeme.c_str()){}
+  functionCall(identASTnode *Name, MutableArrayRef<ASTnode *> Arguments, TOKEN token) : name(Name), arguments(Arguments), caller(token){}
   virtual Value *codegen() override;
-  virtual std::string to_string() const override{
-    std::string stringy = "";
-    for (size_t i = 0; i < indentation; i++)
-    {
-      if(i == 0) stringy += indent;
-      else stringy = stringy + "|      ";
-    }
-    stringy += "├──call to: " + name->to_string() +"\n";
-    indentation++;
-    if(arguments.size() > 0){
-      for (size_t i = 0; i < indentation; i++)
-      {
-        if(i == 0) stringy += indent;
-        else stringy = stringy + "|      ";
-      }
-      usestart = false;
-      stringy = stringy +"├──Argument: " + arguments[0]->to_string();
-      usestart = true;
-      for (size_t i = 1; i < arguments.size(); i++)
-      {
-        stringy += "\n";
-        for (size_t i = 0; i < indentation; i++)
-        {
-          if(i == 0) stringy += indent;
-          else stringy = stringy + "|      ";
-        }
-        stringy = stringy +"├──Argument: " + arguments[i]->to_string();
-      }      
-    }
-    stringy+="\n";
-    indentation--;
-    return stringy;
-  }
+  virtual void analyze(Sema &S) override;
+  virtual ASTnode *fold(ASTFolder &F) override;
+  virtual unsigned compile(BytecodeCompiler &C, unsigned Dst) override;
+  virtual uint32_t flatten(FlatAST &F) const override;
+  virtual void summarize(ASTSummary &S) const override;
+  virtual void dump(ASTDumper &D) const override;
 };
 
 class externASTnode : public ASTnode {
-  std::unique_ptr<typeASTnode> type;
-  std::unique_ptr<identASTnode> identifer;
-  std::vector<std::unique_ptr<parameterASTnode>> parameters;
+  typeASTnode *type;
+  identASTnode *identifer;
+  ArrayRef<parameterASTnode *> parameters;
 public:
-  externASTnode(std::unique_ptr<typeASTnode> Type, std::unique_ptr<identASTnode> Identifier, std::vector<std::unique_ptr<parameterASTnode>> Parameters)
-  : type(std::move(Type)), identifer(std::move(Identifier)), parameters(std::move(Parameters)) {}
+  externASTnode(typeASTnode *Type, identASTnode *Identifier, ArrayRef<parameterASTnode *> Parameters)
+  : type(Type), identifer(Identifier), parameters(Parameters) {}
   virtual Function *codegen() override;
+  virtual void analyze(Sema &S) override;
+  virtual ASTnode *fold(ASTFolder &F) override;
+  virtual unsigned compile(BytecodeCompiler &C, unsigned Dst) override;
+  virtual uint32_t flatten(FlatAST &F) const override;
+  virtual void summarize(ASTSummary &S) const override;
 
   int getType() {
     return type->getType();
   }
-  std::string getName(){
-    return identifer->to_string();
+  StringRef getName() const {
+    return identifer->getName();
   }
-
-  std::string to_string() const override {
-    std::string stringy = "function: " + identifer->to_string() + "\n";
-    stringy = stringy + getIndent() + "|  " + "type: " + type->to_string() + "\n";
-    stringy = stringy + getIndent() + "|  " + "parameters: " + "\n";
-    indentation++;
-    for (size_t i = 0; i < parameters.size(); i++)
-    {
-      for (size_t j = 0; j < indentation -1; j++)
-      {
-        stringy = stringy + indent + "|";
-      }
-      stringy += indent + "  ├──";
-      stringy = stringy + parameters.at(i)->to_string().c_str() + "\n";
-    }
-    indentation--;
-    return stringy;
+  unsigned getSymbol(){
+    return identifer->getSymbol();
   }
+  parameterASTnode *getParameter(size_t i){
+    return parameters[i];
+  }
+  ArrayRef<parameterASTnode *> getParameters() const {
+    return parameters;
+  }
+
+  virtual void dump(ASTDumper &D) const override;
 };
 
 
 class functionASTnode : public ASTnode{
-  std::unique_ptr<externASTnode> function;
-  std::unique_ptr<BlockASTnode> funcBody;
+  externASTnode *function;
+  BlockASTnode *funcBody;
+  unsigned NumSlots = 0; // Locals and parameters, counted by Sema
 public:
-  functionASTnode(std::unique_ptr<externASTnode> Function, std::unique_ptr<BlockASTnode> FuncBody) : function(std::move(Function)), funcBody(std::move(FuncBody)) {}
+  functionASTnode(externASTnode *Function, BlockASTnode *FuncBody) : function(Function), funcBody(FuncBody) {}
   virtual Function *codegen() override;
+  virtual void analyze(Sema &S) override;
+  virtual ASTnode *fold(ASTFolder &F) override;
+  virtual unsigned compile(BytecodeCompiler &C, unsigned Dst) override;
+  virtual uint32_t flatten(FlatAST &F) const override;
+  virtual void summarize(ASTSummary &S) const override;
 
-  virtual std::string to_string() const override{
-    std::string stringy = "function: ";
-    stringy += function->getName() +"\n";
-    for (size_t i = 0; i < indentation; i++)
-    {
-      if(i == 0) stringy += indent ;
-      else stringy = stringy + "|      ";
-    }
-    stringy += "|  body: ";
-    if(funcBody) {
-      indentation++;
-      stringy = stringy + funcBody->to_string().c_str();
-    }
-    else stringy += "[empty]";
-    return stringy;
-  }
+  virtual void dump(ASTDumper &D) const override;
 };
 
 class whileASTnode : public ASTnode{
-  std::unique_ptr<ASTnode> expr;
-  std::unique_ptr<ASTnode> stmt;
+  ASTnode *expr;
+  ASTnode *stmt;
 
 public:
-  whileASTnode(std::unique_ptr<ASTnode> expression, std::unique_ptr<ASTnode> statement) : expr(std::move(expression)), stmt(std::move(statement)){}
+  whileASTnode(ASTnode *expression, ASTnode *statement) : expr(expression), stmt(statement){}
   virtual Value *codegen() override;
+  virtual void analyze(Sema &S) override;
+  virtual ASTnode *fold(ASTFolder &F) override;
+  virtual unsigned compile(BytecodeCompiler &C, unsigned Dst) override;
+  virtual uint32_t flatten(FlatAST &F) const override;
+  virtual void summarize(ASTSummary &S) const override;
 
-  virtual std::string to_string() const override{
-    std::string stringy = "";
-    for (size_t i = 0; i < indentation; i++)
-    {
-      if(i == 0) stringy += indent ;
-      else stringy = stringy + "|      ";
-    }
-    stringy = stringy + "├──While statement: ";
-    usestart = false;
-    stringy = stringy  + expr->to_string().c_str();
-    usestart = true;
-    indentation++;
-    stringy = stringy + "\n" + stmt->to_string().c_str();
-    indentation--;
-    return stringy;
-  }
+  virtual void dump(ASTDumper &D) const override;
 };
 
 
 class programASTnode : public ASTnode{
-  std::vector<std::unique_ptr<externASTnode>> externList;
-  std::vector<std::unique_ptr<ASTnode>> declList;
+  ArrayRef<externASTnode *> externList;
+  ArrayRef<ASTnode *> declList;
 public:
-  virtual ~programASTnode(){};
-  programASTnode(std::vector<std::unique_ptr<externASTnode>> Externs, std::vector<std::unique_ptr<ASTnode>> Decls) : externList(std::move(Externs)), declList(std::move(Decls)) {}
-  programASTnode(std::vector<std::unique_ptr<ASTnode>> Decls) : declList(std::move(Decls)) {}
+  programASTnode(ArrayRef<externASTnode *> Externs, ArrayRef<ASTnode *> Decls) : externList(Externs), declList(Decls) {}
+  programASTnode(ArrayRef<ASTnode *> Decls) : declList(Decls) {}
   virtual Value *codegen() override;
+  virtual void analyze(Sema &S) override;
+  virtual ASTnode *fold(ASTFolder &F) override;
+  virtual unsigned compile(BytecodeCompiler &C, unsigned Dst) override;
+  virtual uint32_t flatten(FlatAST &F) const override;
+  virtual void summarize(ASTSummary &S) const override;
 
-  virtual std::string to_string() const override{
-    std::string stringy = "--------------AST-------------\n";
-    int size1 = externList.size();
-    int size2 = declList.size();
-    if(size1>0) indentation++;
-    stringy = stringy + "Externs:\n";
-    for (size_t i = 0; i < size1; i++)
-    {
-      stringy = stringy + getIndent() + "├──"+ externList.at(i)->to_string().c_str();
-    }
-    if(size1>0) indentation--;
-    if(size2>0) indentation++;
-    stringy = stringy + "Declarations:\n";
-    for (size_t i = 0; i < size2; i++)
-    { 
-      stringy = stringy + getIndent() + "├──"+ declList.at(i)->to_string().c_str();
-    }
-    if(size2>0) indentation--;
-    return stringy;
-  }
+  virtual void dump(ASTDumper &D) const override;
 };
 
 
@@ -1010,56 +1476,203 @@ public:
 // Recursive Descent Parser - Function call for each production
 //===----------------------------------------------------------------------===//
 
+//===----------------------------------------------------------------------===//
+// Operator precedence
+//===----------------------------------------------------------------------===//
+
+// Binding power of each binary operator, one level per expression production
+// of grammar.txt from rval (loosest) down to factor (tightest).
+struct BinaryOperatorInfo {
+  int Token;
+  int Precedence;
+  BinOp Op;
+};
+
+static constexpr BinaryOperatorInfo BinaryOperators[] = {
+    {OR, 1, BinOp::Or},                                         // rval
+    {AND, 2, BinOp::And},                                       // term
+    {EQ, 3, BinOp::EQ},      {NE, 3, BinOp::NE},                // equivalence
+    {LE, 4, BinOp::LE},      {LT, 4, BinOp::LT},                // relational
+    {GE, 4, BinOp::GE},      {GT, 4, BinOp::GT},
+    {PLUS, 5, BinOp::Add},   {MINUS, 5, BinOp::Sub},            // subexpr
+    {ASTERIX, 6, BinOp::Mul}, {DIV, 6, BinOp::Div}, {MOD, 6, BinOp::Rem}, // factor
+};
+
+// Token types run from -23 (GE) up to '>', so offset them into a dense table.
+static constexpr int MinTokenType = -32;
+static constexpr int TokenTypeRange = 128;
+
+struct PrecedenceTable {
+  signed char Precedence[TokenTypeRange] = {};
+  BinOp Op[TokenTypeRange] = {};
+
+  constexpr PrecedenceTable() {
+    for (int i = 0; i < TokenTypeRange; i++)
+      Precedence[i] = -1;
+    for (const BinaryOperatorInfo &Info : BinaryOperators) {
+      Precedence[Info.Token - MinTokenType] = Info.Precedence;
+      Op[Info.Token - MinTokenType] = Info.Op;
+    }
+  }
+};
+
+static constexpr PrecedenceTable BinaryPrecedence;
+
+/// getBinaryPrecedence - Binding power of the binary operator TokType, or -1
+/// if it is not one.
+static int getBinaryPrecedence(int TokType) {
+  unsigned Index = TokType - MinTokenType;
+  return Index < TokenTypeRange ? BinaryPrecedence.Precedence[Index] : -1;
+}
+
+/// getBinOp - The operator for TokType, which must be a binary operator.
+static BinOp getBinOp(int TokType) {
+  assert(getBinaryPrecedence(TokType) >= 0 && "not a binary operator");
+  return BinaryPrecedence.Op[TokType - MinTokenType];
+}
+
+//===----------------------------------------------------------------------===//
+// Parser
+//===----------------------------------------------------------------------===//
+
+/// Parser - Recursive descent parser for one translation unit. The parser owns
+/// its token stream, cursor and error count, and its unit's names and errors
+/// go to a table and a stream of the unit's own, so separate translation units
+/// can be parsed concurrently on separate threads.
+class Parser {
+  const SourceBuffer &Source;
+  ASTContext &AST;
+  StringInterner &Symbols;
+  raw_ostream &Errs;
+  ParallelLexOptions LexOpts;
+  TokenStream Tokens;
+  size_t NextTokIdx = 0;
+  int errorCount = 0;
+
+  /// CurTok/getNextToken - Provide a simple token cursor.  The whole file is
+  /// lexed into Tokens before parsing starts.  CurTok is the current token the
+  /// parser is looking at, getNextToken advances the cursor and updates CurTok
+  /// with its results, and peekTokenType looks any distance ahead of CurTok.
+  /// The cursor stops on the final EOF_TOK.
+  TOKEN CurTok;
+
+  TOKEN getNextToken() {
+    size_t Idx = std::min(NextTokIdx, Tokens.size() - 1);
+    if (NextTokIdx < Tokens.size())
+      NextTokIdx++;
+    return CurTok = Tokens[Idx];
+  }
+
+  int peekTokenType(size_t Distance) {
+    return Tokens.getType(std::min(NextTokIdx - 1 + Distance, Tokens.size() - 1));
+  }
+
+  /// report - Print a syntax error message, formatted as by printf.
+  template <typename... Ts> void report(const char *Fmt, const Ts &... Vals) {
+    Errs << format(Fmt, Vals...);
+  }
+
+  identASTnode *createIdent(TOKEN Tok) {
+    return AST.create<identASTnode>(Tok, Symbols.getName(Tok.symbol));
+  }
+
+  void line();
+  void errorMessage();
+  bool argListChecker();
+  bool curTokType(TOKEN Current);
+  bool exprstmt();
+  bool checkTerm(int size, int tokens[13]);
+  std::vector<ASTnode *> ArgsListPrimeParser();
+  std::vector<ASTnode *> ArgsListParser();
+  functionCall *leftParanthesis(TOKEN identifier);
+  ASTnode *ElementParser();
+  ASTnode *rvalParser();
+  ASTnode *binaryOpParser(int MinPrecedence, ASTnode *LHS);
+  ASTnode *expressionParser();
+  ASTnode *expressionStatementParser();
+  returnASTnode *returnStatementParser();
+  ASTnode *statementParser();
+  std::vector<parameterASTnode *> parameterlistPrimeParser();
+  std::vector<parameterASTnode *> parameterListParser();
+  typeASTnode *varighttypeParser();
+  std::vector<ASTnode *> statementListParser();
+  globalASTnode *localDeclParser();
+  std::vector<parameterASTnode *> paramsParser();
+  std::vector<globalASTnode *> localDeclsParser();
+  BlockASTnode *blockParser();
+  BlockASTnode *elseParser();
+  ifASTnode *ifParser();
+  whileASTnode *whileParser();
+  typeASTnode *typeSpecParser();
+  parameterASTnode *variableDeclarationParser();
+  functionASTnode *functionDeclarationParser();
+  parameterASTnode *paramParser();
+  ASTnode *declParser();
+  std::vector<ASTnode *> EOFparser();
+  std::vector<ASTnode *> declPrimeParser();
+  std::vector<ASTnode *> declListParser();
+  externASTnode *externParser();
+  std::vector<externASTnode *> externListPrimeParser();
+  std::vector<externASTnode *> externListParser();
+  std::vector<ASTnode *> globalsListParser();
+  ASTnode *parser();
+
+public:
+  /// Parser - Parse Source into AST, interning its names into Symbols and
+  /// reporting its syntax errors to Errs.
+  Parser(const SourceBuffer &Source, ASTContext &AST, StringInterner &Symbols,
+         raw_ostream &Errs, ParallelLexOptions LexOpts = ParallelLexOptions())
+      : Source(Source), AST(AST), Symbols(Symbols), Errs(Errs),
+        LexOpts(LexOpts) {}
+
+  /// parse - Lex the whole translation unit and parse it into a program.
+  ASTnode *parse() {
+    lexParallel(Source, Tokens, Symbols, LexOpts);
+    getNextToken();
+    return parser();
+  }
+
+  int getErrorCount() const { return errorCount; }
+};
+
 /* Add function calls for each production */
 
-//static std::unique_ptr<ASTnode> ElementParser(){
+//static ASTnode *ElementParser(){
 
-static void line(){
+void Parser::line(){
   errorCount++;
-  printf("============================\n~ERROR %d~\n", errorCount);
+  report("============================\n~ERROR %d~\n", errorCount);
 }
 
-static void errorMessage(){
-  printf("TOKEN: Unexpected Token, %s, encountered.\nLOCATION: '%s' was found at Row,Column [%d,%d] \n", CurTok.lexeme.c_str(), CurTok.lexeme.c_str(), CurTok.lineNo, CurTok.columnNo);
+void Parser::errorMessage(){
+  std::string lexeme = CurTok.getLexeme(Source).str();
+  auto location = Source.getLineAndColumn(CurTok.offset);
+  report("TOKEN: Unexpected Token, %s, encountered.\nLOCATION: '%s' was found at Row,Column [%d,%d] \n", lexeme.c_str(), lexeme.c_str(), location.first, location.second);
 }
 
-static std::unique_ptr<ASTnode> expressionParser();
-static std::unique_ptr<ASTnode> subExprParser();
 
-static std::unique_ptr<ifASTnode> ifParser();
-static std::unique_ptr<whileASTnode> whileParser();
-static std::unique_ptr<BlockASTnode> blockParser();
-static std::unique_ptr<parameterASTnode> paramParser();
 
 
 
-static bool argListChecker(){
+bool Parser::argListChecker(){
   if(CurTok.type == COMMA ) return false;
   if(CurTok.type == RPAR) return false;
   return true;
 }
 
-static bool curTokType(TOKEN Current){
+bool Parser::curTokType(TOKEN Current){
   if (Current.type == INT_LIT || Current.type == FLOAT_LIT || Current.type == BOOL_LIT || Current.type == MINUS || Current.type == NOT || Current.type == IDENT || Current.type == LPAR){
     return true;
   }
   return false;
 }
 
-static bool exprstmt(){
+bool Parser::exprstmt(){
   if(CurTok.type==INT_LIT || CurTok.type==BOOL_LIT || CurTok.type==FLOAT_LIT || CurTok.type==IDENT || CurTok.type==SC || CurTok.type==LBRA || CurTok.type==MINUS || CurTok.type==NOT || CurTok.type==LPAR) return false;
   return true;
 }
 
-static bool AndTerm(){
-  return(CurTok.type==AND || (CurTok.type==IDENT || CurTok.type==SC || CurTok.type==COMMA || CurTok.type==RPAR || CurTok.type==MINUS || CurTok.type==NOT || CurTok.type==LPAR || CurTok.type==INT_LIT || CurTok.type==BOOL_LIT || CurTok.type==FLOAT_LIT || CurTok.type==OR));
-}
-
-static bool OrTerm(){
-  return(CurTok.type == OR || CurTok.type==AND || (CurTok.type==IDENT || CurTok.type==SC || CurTok.type==COMMA || CurTok.type==RPAR || CurTok.type==MINUS || CurTok.type==NOT || CurTok.type==LPAR || CurTok.type==INT_LIT || CurTok.type==BOOL_LIT || CurTok.type==FLOAT_LIT || CurTok.type==OR));
-}
-
-static bool checkTerm(int size, int tokens[13]){
+bool Parser::checkTerm(int size, int tokens[13]){
   for (size_t i = 0; i < size; i++)
   {
     if(CurTok.type == tokens[i]) return false;
@@ -1068,12 +1681,12 @@ static bool checkTerm(int size, int tokens[13]){
 }
 
 
-static std::vector<std::unique_ptr<ASTnode>> ArgsListPrimeParser(){
-  std::vector<std::unique_ptr<ASTnode>> stdList;
-  std::vector<std::unique_ptr<ASTnode>> vector;
+std::vector<ASTnode *> Parser::ArgsListPrimeParser(){
+  std::vector<ASTnode *> stdList;
+  std::vector<ASTnode *> vector;
 
   if(argListChecker() == true){
-    line();printf("ERROR: Missing ',' or ')'\n");
+    line();report("ERROR: Missing ',' or ')'\n");
     errorMessage();
     return vector;
   }
@@ -1082,23 +1695,24 @@ static std::vector<std::unique_ptr<ASTnode>> ArgsListPrimeParser(){
     {
       case COMMA:
         getNextToken();
+        break;
       default:
-        std::string printable = "============================\nERROR: Token " + CurTok.lexeme + " is not ',' (COMMA) as expected\n";
+        std::string printable = "============================\nERROR: Token " + CurTok.getLexeme(Source).str() + " is not ',' (COMMA) as expected\n";
         errorMessage();     
         break;
     }
     auto expr = expressionParser();
     auto args = ArgsListPrimeParser();
-    if(expr) {stdList.push_back(std::move(expr));}
+    if(expr) {stdList.push_back(expr);}
     int size = (int) args.size();
     for (size_t i = 0; i < size; i++)
     {
-      stdList.push_back(std::move(args[i]));
+      stdList.push_back(args[i]);
     }
   }
   else{
     if(CurTok.type != RPAR){
-      line();printf("ERROR: Expected token RPAR ')'\n");
+      line();report("ERROR: Expected token RPAR ')'\n");
       errorMessage();   
       return vector;
     }
@@ -1107,12 +1721,12 @@ static std::vector<std::unique_ptr<ASTnode>> ArgsListPrimeParser(){
   return stdList;
 }
 
-static std::vector<std::unique_ptr<ASTnode>> ArgsListParser(){
-  std::vector<std::unique_ptr<ASTnode>> stdList;
-  std::vector<std::unique_ptr<ASTnode>> vector;
+std::vector<ASTnode *> Parser::ArgsListParser(){
+  std::vector<ASTnode *> stdList;
+  std::vector<ASTnode *> vector;
 
   if(curTokType(CurTok) == false && CurTok.type != RPAR){
-    line();printf("ERROR: Expected an identifier, literal or one of [MINUS '-', NOT '!', LPAR '(']");
+    line();report("ERROR: Expected an identifier, literal or one of [MINUS '-', NOT '!', LPAR '(']");
     errorMessage();   
     return vector;
   }
@@ -1121,45 +1735,45 @@ static std::vector<std::unique_ptr<ASTnode>> ArgsListParser(){
   auto args = ArgsListPrimeParser();
 
   if(CurTok.type != RPAR){
-    line();printf("ERROR: Expected token RPAR ')'");
+    line();report("ERROR: Expected token RPAR ')'");
     errorMessage();   
     return vector;
   }
-  if(expr) {stdList.push_back(std::move(expr));}
+  if(expr) {stdList.push_back(expr);}
   int size = (int) args.size();
   for (size_t i = 0; i < size; i++)
   {
-    stdList.push_back(std::move(args[i]));
+    stdList.push_back(args[i]);
   }
   
   return stdList;
 }
 
-static std::unique_ptr<functionCall> leftParanthesis(TOKEN identifier){
-  auto ident = std::make_unique<identASTnode>(identifier, identifier.lexeme);
+functionCall *Parser::leftParanthesis(TOKEN identifier){
+  auto ident = createIdent(identifier);
   getNextToken();
   auto temp = ArgsListParser();
   getNextToken();
-  return std::make_unique<functionCall>(std::move(ident), std::move(temp), identifier);
+  return AST.create<functionCall>(ident, AST.copy(temp), identifier);
 }
 
 
-static std::unique_ptr<ASTnode> ElementParser(){
+ASTnode *Parser::ElementParser(){
   if(CurTok.type == INT_LIT){
-    auto returner = std::make_unique<IntASTnode>(CurTok, IntVal);
-    auto inty = std::move(returner);
+    auto returner = AST.create<IntASTnode>(getIntValue(CurTok.getLexeme(Source)));
+    auto inty = returner;
     getNextToken();
     if(inty) return inty;
   }
   else if(CurTok.type == FLOAT_LIT){
-    auto returner = std::make_unique<floatASTnode>(CurTok, FloatVal);
-    auto floaty = std::move(returner);
+    auto returner = AST.create<floatASTnode>(getFloatValue(CurTok.getLexeme(Source)));
+    auto floaty = returner;
     getNextToken();
     if(floaty) return floaty;
   }
   else if(CurTok.type == BOOL_LIT){
-    auto returner = std::make_unique<boolASTnode>(CurTok, BoolVal);
-    auto booly = std::move(returner);
+    auto returner = AST.create<boolASTnode>(getBoolValue(CurTok.getLexeme(Source)));
+    auto booly = returner;
     getNextToken();
     if(booly) return booly;
   }
@@ -1169,8 +1783,8 @@ static std::unique_ptr<ASTnode> ElementParser(){
     getNextToken();
     auto element = ElementParser();
     if(element){
-      auto neg = std::make_unique<notAndNegativeASTnode>(oper, negativeToken, std::move(element));
-      return std::move(neg);
+      auto neg = AST.create<notAndNegativeASTnode>(oper, negativeToken, element);
+      return neg;
     }
   }
   else if(CurTok.type == NOT){
@@ -1180,8 +1794,8 @@ static std::unique_ptr<ASTnode> ElementParser(){
     auto element = ElementParser();
     auto newResult = nullptr;
     if(element){
-      auto neg = std::make_unique<notAndNegativeASTnode>(oper, notToken, std::move(element));
-      return std::move(neg);
+      auto neg = AST.create<notAndNegativeASTnode>(oper, notToken, element);
+      return neg;
     }
   }
   else if(CurTok.type == IDENT){
@@ -1189,15 +1803,11 @@ static std::unique_ptr<ASTnode> ElementParser(){
     getNextToken();
     if(CurTok.type == LPAR) {
       auto lpar = leftParanthesis(identifier);
-      return std::move(lpar);
+      return lpar;
     }
     else{
-      putBackToken(CurTok);
-      putBackToken(identifier);
-      getNextToken();
-      auto ident = std::make_unique<identASTnode>(CurTok, CurTok.lexeme);
-      getNextToken();
-      if(std::move(ident)) return std::move(ident);
+      auto ident = createIdent(identifier);
+      if(ident) return ident;
     }
   }
   else if(CurTok.type == LPAR){
@@ -1213,7 +1823,7 @@ static std::unique_ptr<ASTnode> ElementParser(){
       getNextToken();
       //printf("\n");
       //printf("3. %s\n\n", CurTok.lexeme.c_str());
-      return std::move(expression);
+      return expression;
     }
   }
   else{
@@ -1225,240 +1835,71 @@ static std::unique_ptr<ASTnode> ElementParser(){
 }
 
 
-static std::unique_ptr<ASTnode> factorPrimeParser(std::unique_ptr<ASTnode> LHS){
-  int t = CurTok.type;
-  TOKEN ooperator = CurTok;
-  if((t==ASTERIX) || (t==DIV) || (t==MOD)) {
-    getNextToken();
-    auto element = ElementParser();
-    if(element != nullptr){
-      auto node = std::make_unique<expressionASTnode>(std::move(LHS), ooperator, std::move(element));
-      auto factorPrime = factorPrimeParser(std::move(node));
-      return factorPrime;
-    }
-  }
-  else if(CurTok.type == PLUS || CurTok.type == MINUS || CurTok.type == LE || CurTok.type == LT || CurTok.type == GE || CurTok.type == GT || CurTok.type == EQ || CurTok.type == NE || CurTok.type == OR || CurTok.type == AND || CurTok.type == SC || CurTok.type == RPAR || CurTok.type == COMMA || CurTok.type == EOF_TOK || CurTok.type == EOF){
-    return std::move(LHS);
-  }
-  else{
-    line();
-    printf("ERROR. Missing element -> Expected a literal, variable, identity, '(', '!', or '-'\n");
-    errorMessage(); 
-  }
-  return nullptr;
-}
-
-static std::unique_ptr<ASTnode> factorParser(){
+/// rvalParser - Parse the binary operator expression grammar.txt calls rval,
+/// starting at an element.
+ASTnode *Parser::rvalParser(){
   auto LHS = ElementParser();
   if(LHS){
-    auto factorPrime = factorPrimeParser(std::move(LHS));
-    return factorPrime;
+    return binaryOpParser(0, LHS);
   }
   return nullptr;
 }
 
-static std::unique_ptr<ASTnode> plusOrMinus(){
-  getNextToken();
-  return subExprParser();
-}
-
-static std::unique_ptr<ASTnode> subExprPrimeParser(std::unique_ptr<ASTnode> LHS){
-  TOKEN operatfor = CurTok;
-  int op = CurTok.type;
-  if(CurTok.type == PLUS || CurTok.type ==  MINUS){
-    getNextToken();
-    auto RHS = factorParser();
-    if(RHS){
-      auto ret = std::make_unique<expressionASTnode>(std::move(LHS), operatfor, std::move(RHS));
-      auto subexprPrime = subExprPrimeParser(std::move(ret));
-      return subexprPrime;
+/// binaryOpParser - Precedence climbing over the binary operators. LHS has
+/// been parsed; fold in every following operator that binds at least as
+/// tightly as MinPrecedence, recursing when the next operator binds tighter
+/// than the current one. All operators are left associative.
+ASTnode *Parser::binaryOpParser(int MinPrecedence, ASTnode *LHS){
+  while(true){
+    int precedence = getBinaryPrecedence(CurTok.type);
+    if(precedence < MinPrecedence){
+      if(precedence < 0 && !(CurTok.type == SC || CurTok.type == RPAR || CurTok.type == COMMA || CurTok.type == EOF_TOK)){
+        line();report("ERROR: Missing or invalid AND, OR, RPAR, an identifier, SC, COMMA, RPAR, MINUS, NOT, LPAR or a literal.\n");
+        errorMessage();
+        getNextToken();
+        return nullptr;
+      }
+      return LHS;
     }
-  }
-  else if(CurTok.type == LE || CurTok.type == LT || CurTok.type == GE || CurTok.type == GT || CurTok.type == EQ || CurTok.type == NE || CurTok.type == OR || CurTok.type == AND || CurTok.type == SC|| CurTok.type == RPAR || CurTok.type == COMMA || CurTok.type == EOF || CurTok.type ==EOF_TOK){
-    if (LHS) return LHS;
-  }
-  else{
-    line();printf("ERROR: Missing or invalid AND, OR, RPAR, an identifier, SC, COMMA, RPAR, MINUS, NOT, LPAR or a literal.\n");
-    errorMessage();
-    getNextToken();
-  }
-  return nullptr;
-}
-
-static std::unique_ptr<ASTnode> subExprParser(){
-  auto LHS = factorParser();
-  if(LHS){
-    auto subExprPrime = subExprPrimeParser(std::move(LHS));
-    return subExprPrime;
-  }
-  return nullptr;
-}
 
-static std::unique_ptr<ASTnode> relationalPrimeParser(std::unique_ptr<ASTnode> LHS){
-  TOKEN comp = CurTok;
-  if(CurTok.type == LE || CurTok.type == LT || CurTok.type == GT || CurTok.type == GE){
-    getNextToken();
-    auto sub = subExprParser();
-    if(sub != nullptr){
-      auto node = std::make_unique<expressionASTnode>(std::move(LHS), comp, std::move(sub));
-      return relationalPrimeParser(std::move(node));
-    }
-  }
-  else if(CurTok.type == EQ || CurTok.type == NE || CurTok.type == OR || CurTok.type == AND || CurTok.type == SC|| CurTok.type == RPAR || CurTok.type == COMMA || CurTok.type == EOF || CurTok.type ==EOF_TOK){
-     if(LHS != nullptr) return LHS;
-   }
-  else{
-    line();printf("ERROR: Missing or invalid AND, OR, RPAR, an identifier, SC, COMMA, RPAR, MINUS, NOT, LPAR or a literal.\n");
-    errorMessage();
+    BinOp op = getBinOp(CurTok.type);
     getNextToken();
-  }
-  return nullptr;
-}
-
+    auto RHS = ElementParser();
+    if(!RHS) return nullptr;
 
-static std::unique_ptr<ASTnode> relationalParser(){
-  auto sub = subExprParser();
-  if (sub){
-    auto relational_prime = relationalPrimeParser(std::move(sub));
-    return relational_prime;
-  }
-  return nullptr;
-}
-
-
-static std::unique_ptr<ASTnode> equivalencePrimeParser(std::unique_ptr<ASTnode> LHS){
-  //printf("\n%s\n", rel->to_string().c_str());  
-  TOKEN eqne = CurTok;
-  if(CurTok.type == EQ || CurTok.type == NE){
-    getNextToken();
-    auto rel = relationalParser(); 
-    if(rel != nullptr){
-        return std::move(std::make_unique<expressionASTnode>(std::move(LHS), eqne, std::move(rel)));
+    if(precedence < getBinaryPrecedence(CurTok.type)){
+      RHS = binaryOpParser(precedence + 1, RHS);
+      if(!RHS) return nullptr;
     }
+    LHS = AST.create<expressionASTnode>(LHS, op, RHS);
   }
-  else if(CurTok.type == OR || CurTok.type == AND || CurTok.type == SC|| CurTok.type == RPAR || CurTok.type == COMMA || CurTok.type == EOF || CurTok.type ==EOF_TOK){
-    if(LHS != nullptr){return LHS;}
-  }
-  else{
-    line();printf("ERROR: Missing or invalid AND, OR, RPAR, an identifier, SC, COMMA, RPAR, MINUS, NOT, LPAR or a literal.");
-    errorMessage();   
-    getNextToken();
-  }
-  return nullptr;
-}
-
-static std::unique_ptr<ASTnode> equivalenceParser(){
-  auto rel = relationalParser();
-  if(rel){
-    auto equivalenceprime = equivalencePrimeParser(std::move(rel));
-    return equivalenceprime;
-  }
-  return nullptr;
 }
 
-static std::unique_ptr<ASTnode> termPrimeParser(std::unique_ptr<ASTnode> LHS){
-  TOKEN storeCurrent =  CurTok;
-  if (CurTok.type == AND){
-    // getNextToken();
-    // auto term = termParser();
-    // if(term != nullptr){
-    //   if(eq != nullptr){
-    //     return std::move(std::make_unique<expressionASTnode>(std::move(term), storeCurrent, std::move(eq)));
-    //   }
-    auto RHS = equivalenceParser();
-    auto node = std::make_unique<expressionASTnode>(std::move(LHS), storeCurrent, std::move(RHS));
-    return termPrimeParser(std::move(node));
-    //}
-  }
-  else if(CurTok.type == OR || CurTok.type == SC|| CurTok.type == RPAR || CurTok.type == COMMA || CurTok.type == EOF || CurTok.type ==EOF_TOK){
-    if(LHS != nullptr) return LHS;
-  }
-  else if(!AndTerm()){
-    line();printf("ERROR: Missing or invalid AND, OR, RPAR, an identifier, SC, COMMA, RPAR, MINUS, NOT, LPAR or a literal.\n");
-    errorMessage();   
+ASTnode *Parser::expressionParser(){
+  if (CurTok.type == IDENT && peekTokenType(1) == ASSIGN){
+    auto identifier = createIdent(CurTok);
     getNextToken();
-  }
-  else {
-    line();printf("ERROR: Missing term -> Expected a literal, variable, identity, '(', '!', or '-'\n");
-    errorMessage();  
-  }
-  return nullptr;
-}
-
-std::unique_ptr<ASTnode> termParser(){
-  auto equivalence = equivalenceParser();
-  if(equivalence){
-    auto termPrime = termPrimeParser(std::move(equivalence));
-    return termPrime;
-  }
-  return nullptr;
-}
-
-
-static std::unique_ptr<ASTnode> rvalprimeParser(std::unique_ptr<ASTnode> LHS){
-  if(CurTok.type == OR){
-    TOKEN storeCurrent = CurTok;
     getNextToken();
-    auto RHS = termParser();
-    if(RHS != nullptr){
-      return std::move(std::make_unique<expressionASTnode>(std::move(LHS), storeCurrent, std::move(RHS)));
+    auto expr = expressionParser();
+    if(expr){
+      return AST.create<assignmentASTnode>(identifier, expr);
     }
-  }
-  else if(CurTok.type == SC|| CurTok.type == RPAR || CurTok.type == COMMA || CurTok.type == EOF || CurTok.type ==EOF_TOK){
-    if(LHS != nullptr) return LHS;
-  }
-  else if(!OrTerm()){
-    line();printf("ERROR: Missing or invalid AND, OR, RPAR, an identifier, SC, COMMA, RPAR, MINUS, NOT, LPAR or a literal.\n");
-    errorMessage();  
-    getNextToken(); 
     return nullptr;
   }
-  else{
-    line();printf("ERROR: Missing rval -> Expected a literal, variable, identity, '(', '!', or '-' or '||'\n"); 
-    errorMessage();   
-  }
-  return nullptr;
-}
-
-
-static std::unique_ptr<ASTnode> rvalParser(){
-  auto LHS = termParser();
-  if(LHS){
-    return std::move(rvalprimeParser(std::move(LHS)));
-  }
-  return nullptr;
-}
-
-static std::unique_ptr<ASTnode> expressionParser(){
-  if (CurTok.type == IDENT){
-    TOKEN temporaryIdentifierStorage = CurTok;
-    getNextToken();
-    if(CurTok.type == ASSIGN){
-      auto identifier = std::make_unique<identASTnode>(temporaryIdentifierStorage, temporaryIdentifierStorage.lexeme);
-      getNextToken();
-      auto expr = expressionParser();
-      if(expr){
-        return std::move(std::make_unique<assignmentASTnode>(std::move(identifier), std::move(expr)));
-      }
-    }
-    putBackToken(CurTok);
-    putBackToken(temporaryIdentifierStorage);
-    getNextToken();
-  }
   if (curTokType(CurTok)){
     auto rval = rvalParser();
-    if(rval != nullptr) return std::move(rval);
+    if(rval != nullptr) return rval;
   }
   else{
-    line();printf("ERROR: Missing assignment or expression \n");
+    line();report("ERROR: Missing assignment or expression \n");
     errorMessage();
   }
   return nullptr;
 }
 
-static std::unique_ptr<ASTnode> expressionStatementParser(){
+ASTnode *Parser::expressionStatementParser(){
   if(exprstmt() == true){
-    line();printf("ERROR: Missing identifer, literal, or SC ';', NOT '!', LPAR '(', or a literal\n");
+    line();report("ERROR: Missing identifer, literal, or SC ';', NOT '!', LPAR '(', or a literal\n");
     errorMessage();  
     getNextToken(); 
     return nullptr;
@@ -1467,7 +1908,7 @@ static std::unique_ptr<ASTnode> expressionStatementParser(){
     getNextToken();
     int list[13] = {IDENT, SC, LBRA, WHILE, IF, RETURN, MINUS, NOT, LPAR, INT_LIT, BOOL_LIT, FLOAT_LIT, RBRA};
     if(checkTerm(13, list)){
-      line();printf("ERROR: Missing identifier, or SC ';', LBRA '{', RBRA '{', WHILE, IF, MINUS '-', NOT '!', LPAR '(' RETURN, or a literal.\n");
+      line();report("ERROR: Missing identifier, or SC ';', LBRA '{', RBRA '{', WHILE, IF, MINUS '-', NOT '!', LPAR '(' RETURN, or a literal.\n");
       errorMessage();  
       getNextToken(); 
     }
@@ -1480,13 +1921,13 @@ static std::unique_ptr<ASTnode> expressionStatementParser(){
       //printf("%s - %d\n", CurTok.lexeme.c_str(), CurTok.type);
     }
     else{
-      std::string error = "ERROR: No semi colon at line end, instead Token '"+CurTok.lexeme+"' was encountered rather than ';' as expected.\n";
-      line();printf(error.c_str());
+      std::string error = "ERROR: No semi colon at line end, instead Token '"+CurTok.getLexeme(Source).str()+"' was encountered rather than ';' as expected.\n";
+      line();Errs << error;
       errorMessage();  
       getNextToken(); 
     }
     if(!(CurTok.type == EOF_TOK || CurTok.type == EOF || CurTok.type==IDENT || CurTok.type==SC || CurTok.type==LBRA || CurTok.type==WHILE || CurTok.type==IF || CurTok.type==RETURN || CurTok.type==MINUS || CurTok.type==NOT || CurTok.type==LPAR || CurTok.type==INT_LIT || CurTok.type==BOOL_LIT || CurTok.type==FLOAT_LIT || CurTok.type==RBRA)){
-      line();printf("ERROR: Missing identifier, or SC ';', LBRA '{', RBRA '{', WHILE, IF, MINUS '-', NOT '!', LPAR '(' RETURN, or a literal.\n");
+      line();report("ERROR: Missing identifier, or SC ';', LBRA '{', RBRA '{', WHILE, IF, MINUS '-', NOT '!', LPAR '(' RETURN, or a literal.\n");
       errorMessage();  
       getNextToken(); 
     }
@@ -1495,29 +1936,29 @@ static std::unique_ptr<ASTnode> expressionStatementParser(){
   return nullptr;
 }
 
-static std::unique_ptr<returnASTnode> returnStatementParser(){
+returnASTnode *Parser::returnStatementParser(){
   if(CurTok.type == RETURN){
       getNextToken();
       if(CurTok.type == SC){
-        auto returner = std::make_unique<returnASTnode>();
+        auto returner = AST.create<returnASTnode>();
         getNextToken();
         return returner;
       }
       else if(CurTok.type == INT_LIT || CurTok.type == FLOAT_LIT || CurTok.type == BOOL_LIT || CurTok.type == NOT || CurTok.type == LPAR || CurTok.type == IDENT || CurTok.type == MINUS){
         auto expression = expressionParser();
         if(CurTok.type == SC){
-          auto returner = std::make_unique<returnASTnode>(std::move(expression));
+          auto returner = AST.create<returnASTnode>(expression);
           getNextToken();
           return returner;
         }
       }
       else{
-        line();printf("ERROR: Missing semicolon ';' after expression in RETURN statement\n");
+        line();report("ERROR: Missing semicolon ';' after expression in RETURN statement\n");
         errorMessage();
       }
   }
   else{
-    line();printf("ERROR: Missing 'RETURN' before statement\n");
+    line();report("ERROR: Missing 'RETURN' before statement\n");
     errorMessage();
     return nullptr;
   }
@@ -1525,20 +1966,20 @@ static std::unique_ptr<returnASTnode> returnStatementParser(){
 }
 
 
-static std::unique_ptr<ASTnode> statementParser(){
+ASTnode *Parser::statementParser(){
   if(CurTok.type == IF){ //call if;
     auto ifF = ifParser();
-    if(ifF != nullptr) return std::move(ifF);
+    if(ifF != nullptr) return ifF;
   }
   else if(CurTok.type == WHILE)//call while;
   {
     auto whileE = whileParser();
-    if(whileE != nullptr) return std::move(whileE);
+    if(whileE != nullptr) return whileE;
   }
   else if(CurTok.type == RETURN) //call block
   {
     auto returnN = returnStatementParser();
-    if(returnN != nullptr) return std::move(returnN);
+    if(returnN != nullptr) return returnN;
   }
   else if(CurTok.type == LBRA) //call block;
   {
@@ -1547,22 +1988,22 @@ static std::unique_ptr<ASTnode> statementParser(){
   }
   else if(CurTok.type == INT_LIT || CurTok.type == BOOL_LIT || CurTok.type ==  FLOAT_LIT || CurTok.type == MINUS || CurTok.type == NOT ||CurTok.type == SC || CurTok.type == LPAR || CurTok.type == IDENT){
     auto expressionStatements = expressionStatementParser();
-    if(expressionStatements) return std::move(expressionStatements);
+    if(expressionStatements) return expressionStatements;
     return nullptr;
   }
   else{
-    line();printf("ERROR: No statement definition\n");
+    line();report("ERROR: No statement definition\n");
     errorMessage();
   }
   return nullptr;
 }
 
-static std::vector<std::unique_ptr<parameterASTnode>> parameterlistPrimeParser(){
-  std::vector<std::unique_ptr<parameterASTnode>> parameters;
-  std::vector<std::unique_ptr<parameterASTnode>> vector;
+std::vector<parameterASTnode *> Parser::parameterlistPrimeParser(){
+  std::vector<parameterASTnode *> parameters;
+  std::vector<parameterASTnode *> vector;
   if(CurTok.type != COMMA) {
     if(CurTok.type != RPAR){
-      line();printf("ERROR: Missing COMMA ','\n");
+      line();report("ERROR: Missing COMMA ','\n");
       errorMessage();
       return vector;
     }
@@ -1573,19 +2014,19 @@ static std::vector<std::unique_ptr<parameterASTnode>> parameterlistPrimeParser()
     auto paramPrimeList = parameterlistPrimeParser();
 
     if(parameter){
-      parameters.push_back(std::move(parameter));
+      parameters.push_back(parameter);
     }
     int size = (int)paramPrimeList.size();
     for (size_t i = 0; i < size; i++)
     {
-      parameters.push_back(std::move(paramPrimeList[i]));
+      parameters.push_back(paramPrimeList[i]);
     }
     
     if(CurTok.type == RPAR){
       return parameters;
     }
     else{
-      line();printf("ERROR: Missing RajghPAR ')'\n");
+      line();report("ERROR: Missing RajghPAR ')'\n");
       errorMessage();
       return vector;
     }
@@ -1594,12 +2035,12 @@ static std::vector<std::unique_ptr<parameterASTnode>> parameterlistPrimeParser()
   return vector;
 }
 
-static std::vector<std::unique_ptr<parameterASTnode>> parameterListParser(){
-  std::vector<std::unique_ptr<parameterASTnode>> parameters;
-  std::vector<std::unique_ptr<parameterASTnode>> vector;
+std::vector<parameterASTnode *> Parser::parameterListParser(){
+  std::vector<parameterASTnode *> parameters;
+  std::vector<parameterASTnode *> vector;
   if(CurTok.type == EOF_TOK) return vector;
   if(CurTok.type != INT_TOK && CurTok.type != FLOAT_TOK && CurTok.type != BOOL_TOK){
-    line();printf("ERROR: Variable has no type, expected type before variable declaration\n");
+    line();report("ERROR: Variable has no type, expected type before variable declaration\n");
     errorMessage();
     return vector;
   }
@@ -1608,18 +2049,18 @@ static std::vector<std::unique_ptr<parameterASTnode>> parameterListParser(){
   auto parameterPrimes = parameterlistPrimeParser();
 
   if(parameter){
-    parameters.push_back(std::move(parameter));
+    parameters.push_back(parameter);
   }
   int size = (int) parameterPrimes.size();
   for (int i = 0; i < size; i++)
   {
-    parameters.push_back(std::move(parameterPrimes[i]));
+    parameters.push_back(parameterPrimes[i]);
   }
   if(CurTok.type == RPAR){
       return parameters;
   }
   else{
-      line();printf("ERROR: Missing RPAR ')'\n");
+      line();report("ERROR: Missing RPAR ')'\n");
       errorMessage();
       return vector;
     }
@@ -1627,57 +2068,57 @@ static std::vector<std::unique_ptr<parameterASTnode>> parameterListParser(){
 }
 
 
-static std::unique_ptr<typeASTnode> varighttypeParser(){
+typeASTnode *Parser::varighttypeParser(){
   if(CurTok.type == INT_TOK || CurTok.type == FLOAT_TOK || CurTok.type == BOOL_TOK){
     TOKEN storage = CurTok;
     getNextToken();
-    return std::make_unique<typeASTnode>(storage);
+    return AST.create<typeASTnode>(storage);
   }
   else{
-    line();printf("ERROR: invalid variable declaration. %s encountered when 'int' 'bool' or 'float' expected\n", CurTok.lexeme.c_str());
+    line();report("ERROR: invalid variable declaration. %s encountered when 'int' 'bool' or 'float' expected\n", CurTok.getLexeme(Source).str().c_str());
     errorMessage();
     getNextToken();
     return nullptr;
   }
 }
 
-static std::vector<std::unique_ptr<ASTnode>> statementListParser(){
-  std::vector<std::unique_ptr<ASTnode>> statements;
-  std::vector<std::unique_ptr<ASTnode>> listOfStatements;
+std::vector<ASTnode *> Parser::statementListParser(){
+  std::vector<ASTnode *> statements;
+  std::vector<ASTnode *> listOfStatements;
 
   if(CurTok.type == RBRA){
     if(CurTok.type != RBRA){
-      line();printf("ERROR: Missing RBRA '}', instead encountered %s\n", CurTok.lexeme.c_str());
+      line();report("ERROR: Missing RBRA '}', instead encountered %s\n", CurTok.getLexeme(Source).str().c_str());
     }
     return statements;
   }
   if(CurTok.type == INT_LIT || CurTok.type == BOOL_LIT || CurTok.type == FLOAT_LIT || CurTok.type == NOT || CurTok.type == MINUS || CurTok.type == SC || CurTok.type == LPAR || CurTok.type == IDENT || CurTok.type == IF || CurTok.type == RETURN || CurTok.type == WHILE || CurTok.type == LBRA){
     auto st = statementParser();
     if(st){
-      statements.push_back(std::move(st));
+      statements.push_back(st);
     }
     if(CurTok.type == INT_LIT || CurTok.type == BOOL_LIT || CurTok.type == FLOAT_LIT || CurTok.type == NOT || CurTok.type == MINUS || CurTok.type == SC || CurTok.type == LPAR || CurTok.type == IDENT || CurTok.type == IF || CurTok.type == RETURN || CurTok.type == WHILE || CurTok.type == LBRA){
       auto stmts = statementListParser();
       int size = (int) stmts.size();
       for (size_t i = 0; i < size; i++)
       {
-        statements.push_back(std::move(stmts[i]));
+        statements.push_back(stmts[i]);
       }
       
     }
   }
   else{
-    line();printf("ERROR: Statement defined incorrectly\n");
+    line();report("ERROR: Statement defined incorrectly\n");
     errorMessage();
     getNextToken();
   }
   return statements;
 }
 
-static std::unique_ptr<globalASTnode> localDeclParser(){
+globalASTnode *Parser::localDeclParser(){
   if(CurTok.type == RBRA) return nullptr;
   if(!(CurTok.type == INT_TOK || CurTok.type == BOOL_TOK || CurTok.type == FLOAT_TOK)){
-    line();printf("ERROR: Locally declared variable has no type\n");
+    line();report("ERROR: Locally declared variable has no type\n");
     errorMessage();
   }
   else{
@@ -1687,58 +2128,58 @@ static std::unique_ptr<globalASTnode> localDeclParser(){
       TOKEN store = CurTok;
       getNextToken();
     }
-    auto identifier = std::make_unique<identASTnode>(store, store.lexeme);
+    auto identifier = createIdent(store);
     if(CurTok.type == SC){
       getNextToken();
     }
     else{
-      line();printf("ERROR: Missing semi colon at end of declaration. Expected ';'\n");
+      line();report("ERROR: Missing semi colon at end of declaration. Expected ';'\n");
       errorMessage();
       getNextToken();
     }
     if(CurTok.type==INT_TOK || CurTok.type == RBRA || CurTok.type==FLOAT_TOK || CurTok.type==BOOL_TOK || CurTok.type==IDENT || CurTok.type==SC || CurTok.type==LBRA ||CurTok.type==WHILE || CurTok.type==IF || CurTok.type==RETURN || CurTok.type==MINUS || CurTok.type==NOT || CurTok.type==LPAR || CurTok.type==INT_LIT || CurTok.type==BOOL_LIT || CurTok.type==FLOAT_LIT){
-      return std::make_unique<globalASTnode>(std::move(variableType), std::move(identifier));
+      return AST.create<globalASTnode>(variableType, identifier);
     }
     
   }
-  line();printf("ERROR: Missing IDENT in declaration. Expected 'IDENT'\n");
+  line();report("ERROR: Missing IDENT in declaration. Expected 'IDENT'\n");
   errorMessage();
   nullptr;
 }
 
-static std::vector<std::unique_ptr<parameterASTnode>> paramsParser(){
-  std::vector<std::unique_ptr<parameterASTnode>> parameters;
+std::vector<parameterASTnode *> Parser::paramsParser(){
+  std::vector<parameterASTnode *> parameters;
   if(CurTok.type == INT_TOK || CurTok.type == BOOL_TOK || CurTok.type == FLOAT_TOK){
     return parameterListParser();
   }
   if(CurTok.type == VOID_TOK){
-    auto voidD = std::make_unique<typeASTnode>(CurTok);
-    auto parameter = std::make_unique<parameterASTnode>(std::move(voidD), nullptr);
-    parameters.push_back(std::move(parameter));
+    auto voidD = AST.create<typeASTnode>(CurTok);
+    auto parameter = AST.create<parameterASTnode>(voidD, nullptr);
+    parameters.push_back(parameter);
     getNextToken();
     return parameters;
   }
   if(CurTok.type != RPAR){
-    line();printf("ERROR: Parameter has no type, expected either 'INT', 'BOOL', 'FLOAT', or 'VOID'");
+    line();report("ERROR: Parameter has no type, expected either 'INT', 'BOOL', 'FLOAT', or 'VOID'");
     errorMessage();
   }
   
   return parameters;
 }
 
-static std::vector<std::unique_ptr<globalASTnode>> localDeclsParser(){
-  std::vector<std::unique_ptr<globalASTnode>> declarations;
+std::vector<globalASTnode *> Parser::localDeclsParser(){
+  std::vector<globalASTnode *> declarations;
   if(CurTok.type == RBRA) return declarations;
   if(CurTok.type == INT_TOK || CurTok.type == FLOAT_TOK || CurTok.type == BOOL_TOK){
     auto local = localDeclParser();
 
     auto decls = localDeclsParser();
     if(local != nullptr){
-      declarations.push_back(std::move(local));
+      declarations.push_back(local);
     }
     for (auto &&i : decls)
     {
-      declarations.push_back(std::move(i));
+      declarations.push_back(i);
     }  
     return declarations;
   }
@@ -1746,16 +2187,16 @@ static std::vector<std::unique_ptr<globalASTnode>> localDeclsParser(){
     if (CurTok.type==INT_TOK || CurTok.type==FLOAT_TOK || CurTok.type==BOOL_TOK || CurTok.type==IDENT || CurTok.type==SC || CurTok.type==LBRA ||CurTok.type==WHILE || CurTok.type==IF || CurTok.type==RETURN || CurTok.type==MINUS || CurTok.type==NOT || CurTok.type==LPAR || CurTok.type==INT_LIT || CurTok.type==BOOL_LIT || CurTok.type==FLOAT_LIT){
       return declarations;
     }
-    line();printf("ERROR: Incorrect definition of local declaration\n");
+    line();report("ERROR: Incorrect definition of local declaration\n");
     errorMessage();
     getNextToken();
     return declarations;
   }
 }
 
-static std::unique_ptr<BlockASTnode> blockParser(){
+BlockASTnode *Parser::blockParser(){
   if(CurTok.type != LBRA){
-    line();printf("ERROR: Missing LBRA at beginning of block, expected to find '{'\n");
+    line();report("ERROR: Missing LBRA at beginning of block, expected to find '{'\n");
     errorMessage();
     return nullptr;
   }
@@ -1764,26 +2205,26 @@ static std::unique_ptr<BlockASTnode> blockParser(){
     auto declarations = localDeclsParser();
     auto statements = statementListParser();
     if(CurTok.type != RBRA){
-      line();printf("ERROR: Missing RBRA at end of block, expected to find '}'\n");
+      line();report("ERROR: Missing RBRA at end of block, expected to find '}'\n");
       errorMessage();
       return nullptr;
     }
     else{
       getNextToken();
-      return std::make_unique<BlockASTnode>(std::move(declarations), std::move(statements));
+      return AST.create<BlockASTnode>(AST.copy(declarations), AST.copy(statements));
     }
   }
 }
 
-static std::unique_ptr<BlockASTnode> elseParser(){
+BlockASTnode *Parser::elseParser(){
   if(CurTok.type != ELSE && CurTok.type != IDENT && CurTok.type!=SC && CurTok.type!=LBRA && CurTok.type!=WHILE && CurTok.type!=IF && CurTok.type!=RETURN && CurTok.type!=MINUS && CurTok.type!=NOT && CurTok.type!=LPAR && CurTok.type!=INT_LIT && CurTok.type!=BOOL_LIT && CurTok.type!=FLOAT_LIT && CurTok.type!=RBRA && CurTok.type != EOF_TOK){
-    line();printf("ERROR: missing 'ELSE' declaration at the beginning of else block\n");
+    line();report("ERROR: missing 'ELSE' declaration at the beginning of else block\n");
     errorMessage();
   }
   if(CurTok.type == ELSE){
     getNextToken();
     if(CurTok.type != LBRA){
-      line();printf("ERROR: missing LBRA '{' after 'ELSE'\n");
+      line();report("ERROR: missing LBRA '{' after 'ELSE'\n");
       errorMessage();
     }
     auto blockstatement = blockParser();
@@ -1791,13 +2232,13 @@ static std::unique_ptr<BlockASTnode> elseParser(){
       return blockstatement;    
     }
     else{
-      line();printf("ERRORsf: Missing literal, identifier or SC, RBRA, WHILE, IF, RETURN, MINUS, NOT LPAR in ELSE block\n");
+      line();report("ERRORsf: Missing literal, identifier or SC, RBRA, WHILE, IF, RETURN, MINUS, NOT LPAR in ELSE block\n");
       errorMessage();
     }
   }
   else{
     if(CurTok.type != IDENT && CurTok.type!=SC && CurTok.type!=LBRA && CurTok.type!=WHILE && CurTok.type!=IF && CurTok.type!=RETURN && CurTok.type!=MINUS && CurTok.type!=NOT && CurTok.type!=LPAR && CurTok.type!=INT_LIT && CurTok.type!=BOOL_LIT && CurTok.type!=FLOAT_LIT && CurTok.type!=RBRA && CurTok.type != EOF_TOK){
-      line();printf("ERROR: Missing literal, identifier or SC, RBRA, WHILE, IF, RETURN, MINUS, NOT LPAR in ELSE block\n");
+      line();report("ERROR: Missing literal, identifier or SC, RBRA, WHILE, IF, RETURN, MINUS, NOT LPAR in ELSE block\n");
       errorMessage();
     }
   }
@@ -1805,9 +2246,9 @@ static std::unique_ptr<BlockASTnode> elseParser(){
   return nullptr;
 }
 
-static std::unique_ptr<ifASTnode> ifParser(){
+ifASTnode *Parser::ifParser(){
   if(CurTok.type != IF){
-    line();printf("ERROR: Expected 'IF'\n");
+    line();report("ERROR: Expected 'IF'\n");
     errorMessage();
     return nullptr;
   }
@@ -1817,7 +2258,7 @@ static std::unique_ptr<ifASTnode> ifParser(){
       getNextToken();
     }
     else{
-      line();printf("ERROR: Missing required LPAR '(' after IF declaration\n");
+      line();report("ERROR: Missing required LPAR '(' after IF declaration\n");
       errorMessage();
       getNextToken();
     }
@@ -1827,7 +2268,7 @@ static std::unique_ptr<ifASTnode> ifParser(){
       getNextToken();
     }
     else{
-      line();printf("ERROR: Missing required RPAR '(' after IF expression\n");
+      line();report("ERROR: Missing required RPAR '(' after IF expression\n");
       errorMessage();
       getNextToken();
     }
@@ -1835,11 +2276,11 @@ static std::unique_ptr<ifASTnode> ifParser(){
     auto elseStatement = elseParser();
 
     if(CurTok.type==IDENT || CurTok.type==SC || CurTok.type==LBRA || CurTok.type==WHILE || CurTok.type==IF || CurTok.type==RETURN || CurTok.type==MINUS || CurTok.type==NOT || CurTok.type==LPAR || CurTok.type==INT_LIT || CurTok.type==BOOL_LIT || CurTok.type==FLOAT_LIT || CurTok.type==RBRA || CurTok.type == EOF_TOK ) {
-      auto returnBlock = std::make_unique<ifASTnode>(std::move(expression), std::move(ifBlock), std::move(elseStatement));
-      return std::move(returnBlock);
+      auto returnBlock = AST.create<ifASTnode>(expression, ifBlock, elseStatement);
+      return returnBlock;
     }
     else{
-      line();printf("ERROR: Missing literal, identifier or SC, RBRA, WHILE, IF, RETURN, MINUS, NOT LPAR in ELSE block\n");
+      line();report("ERROR: Missing literal, identifier or SC, RBRA, WHILE, IF, RETURN, MINUS, NOT LPAR in ELSE block\n");
       errorMessage();
       return nullptr;
     }
@@ -1847,7 +2288,7 @@ static std::unique_ptr<ifASTnode> ifParser(){
 }
 
 
-static std::unique_ptr<whileASTnode> whileParser(){
+whileASTnode *Parser::whileParser(){
   if(CurTok.type == WHILE){
     getNextToken();
     if(CurTok.type == LPAR){
@@ -1858,22 +2299,22 @@ static std::unique_ptr<whileASTnode> whileParser(){
         auto statement = statementParser();
         if(statement != nullptr){
           if(expression != nullptr){
-            return std::move(std::make_unique<whileASTnode>(std::move(expression), std::move(statement)));
+            return AST.create<whileASTnode>(expression, statement);
           }
         }
       }
       else{
-        line();printf("ERROR: Missing RPAR ')' after 'WHILE' declaration\n");
+        line();report("ERROR: Missing RPAR ')' after 'WHILE' declaration\n");
         errorMessage();
       }
     }
     else{
-      line();printf("ERROR: Missing LPAR '(' after 'WHILE' declaration\n");
+      line();report("ERROR: Missing LPAR '(' after 'WHILE' declaration\n");
       errorMessage();
     }
   }
   else{
-    line();printf("ERROR: Missing 'WHILE' statement declaration\n");
+    line();report("ERROR: Missing 'WHILE' statement declaration\n");
     errorMessage();
     return nullptr;
   }
@@ -1882,31 +2323,31 @@ static std::unique_ptr<whileASTnode> whileParser(){
 
 
 
-static std::unique_ptr<typeASTnode> typeSpecParser(){
+typeASTnode *Parser::typeSpecParser(){
   if(CurTok.type != VOID_TOK){
     if(CurTok.type == INT_TOK || CurTok.type == BOOL_TOK || CurTok.type == FLOAT_TOK){
       return varighttypeParser();
     }
-    line();printf("ERROR: Missing a declaration type\n");
+    line();report("ERROR: Missing a declaration type\n");
     return nullptr;
   }
   else{
     if(CurTok.type == VOID_TOK){
-      auto returnValue = std::make_unique<typeASTnode>(CurTok);
+      auto returnValue = AST.create<typeASTnode>(CurTok);
       getNextToken();
       return returnValue;
     }
     else{
-      line();printf("ERROR: %s doesn't match expected type VOID_TOK\n", CurTok.lexeme.c_str());
+      line();report("ERROR: %s doesn't match expected type VOID_TOK\n", CurTok.getLexeme(Source).str().c_str());
       errorMessage();
     }
   }
   return nullptr;
 }
 
-static std::unique_ptr<parameterASTnode> variableDeclarationParser(){
+parameterASTnode *Parser::variableDeclarationParser(){
   if(CurTok.type != INT_TOK && CurTok.type != FLOAT_TOK && CurTok.type != BOOL_TOK){
-    line();printf("ERROR: No type in variable declartion, needed INT BOOL or FLOAT\n");
+    line();report("ERROR: No type in variable declartion, needed INT BOOL or FLOAT\n");
     errorMessage();
     return nullptr;
   }
@@ -1931,12 +2372,12 @@ static std::unique_ptr<parameterASTnode> variableDeclarationParser(){
   // // getNextToken();
   // printf("\n");
   
-  auto ident = std::make_unique<identASTnode>(CurTok, CurTok.lexeme);
+  auto ident = createIdent(CurTok);
   if(CurTok.type == IDENT){
     getNextToken();
   }
   else{
-    line();printf("ERROR: Missing Identifier\n");
+    line();report("ERROR: Missing Identifier\n");
     errorMessage();
   }
 
@@ -1944,31 +2385,31 @@ static std::unique_ptr<parameterASTnode> variableDeclarationParser(){
     getNextToken();
   }
   else{
-    line();printf("ERROR: Missing SC ';' after identifier\n");
+    line();report("ERROR: Missing SC ';' after identifier\n");
     errorMessage();
   }
   if(CurTok.type != INT_TOK && CurTok.type != FLOAT_TOK && CurTok.type != BOOL_TOK && CurTok.type != VOID_TOK && CurTok.type != EOF){
-    line();printf("ERROR: Expected a new declaration (INT BOOL FLOAT OR VOID) or an EOF\n");
+    line();report("ERROR: Expected a new declaration (INT BOOL FLOAT OR VOID) or an EOF\n");
     errorMessage();
     return nullptr;
   }
-  return std::make_unique<parameterASTnode>(std::move(type), std::move(ident));
+  return AST.create<parameterASTnode>(type, ident);
 }
 
-static std::unique_ptr<functionASTnode> functionDeclarationParser(){
+functionASTnode *Parser::functionDeclarationParser(){
   auto typeSpec = typeSpecParser();
   // printf("\nFunction type: %s\n", typeSpec->to_string().c_str());
   // printf(CurTok.lexeme.c_str());
   if(CurTok.type != IDENT){
-    line();printf("ERROR: Expected an identifier\n");
+    line();report("ERROR: Expected an identifier\n");
     errorMessage();
   }
-  auto identifier = std::make_unique<identASTnode>(CurTok, CurTok.lexeme);
+  auto identifier = createIdent(CurTok);
   if(CurTok.type == IDENT){
     getNextToken();
   }
   if(CurTok.type != LPAR){
-    line();printf("ERROR: Missing LPAR '('\n");
+    line();report("ERROR: Missing LPAR '('\n");
     errorMessage();
   }
   else{
@@ -1976,47 +2417,47 @@ static std::unique_ptr<functionASTnode> functionDeclarationParser(){
   }
   auto parameters = paramsParser();
   if(CurTok.type != RPAR){
-    line();printf("ERROR: Missing or incorrect placement of RPAR ')'\n");
+    line();report("ERROR: Missing or incorrect placement of RPAR ')'\n");
     errorMessage();
   }
   getNextToken();
   auto block = blockParser();
-  auto function = std::make_unique<externASTnode>(std::move(typeSpec), std::move(identifier), std::move(parameters));
-  return std::make_unique<functionASTnode>(std::move(function), std::move(block));
+  auto function = AST.create<externASTnode>(typeSpec, identifier, AST.copy(parameters));
+  return AST.create<functionASTnode>(function, block);
 }
 
 
-static std::unique_ptr<parameterASTnode> paramParser(){
+parameterASTnode *Parser::paramParser(){
   // if(CurTok.type != INT_TOK && CurTok.type != FLOAT_TOK && CurTok.type != BOOL_TOK){
     
   // }
   auto variableType = varighttypeParser();
   if(CurTok.type == IDENT){
-    auto identifier = std::make_unique<identASTnode>(CurTok, CurTok.lexeme);
+    auto identifier = createIdent(CurTok);
     getNextToken();
     if(CurTok.type != RPAR && CurTok.type != COMMA && CurTok.type != SC){
-      line();printf("ERROR: Expected COMMA ',' SC';' OR RPAR ')' instead encountered %s", CurTok.lexeme.c_str());
+      line();report("ERROR: Expected COMMA ',' SC';' OR RPAR ')' instead encountered %s", CurTok.getLexeme(Source).str().c_str());
       errorMessage();
       return nullptr;
     }
-    return std::make_unique<parameterASTnode>(std::move(variableType), std::move(identifier));
+    return AST.create<parameterASTnode>(variableType, identifier);
   }
   else{
-    line();printf("ERROR: Missing IDENT, %s is not of type IDENT", CurTok.lexeme.c_str());
+    line();report("ERROR: Missing IDENT, %s is not of type IDENT", CurTok.getLexeme(Source).str().c_str());
     errorMessage();
-    auto identifier = std::make_unique<identASTnode>(CurTok, CurTok.lexeme);
+    auto identifier = createIdent(CurTok);
     if(CurTok.type != RPAR && CurTok.type != COMMA && CurTok.type != SC){
-      line();printf("ERROR: Expected COMMA ',' SC';' OR RPAR ')' instead encountered %s", CurTok.lexeme.c_str());
+      line();report("ERROR: Expected COMMA ',' SC';' OR RPAR ')' instead encountered %s", CurTok.getLexeme(Source).str().c_str());
       errorMessage();
       return nullptr;
     }
-    return std::make_unique<parameterASTnode>(std::move(variableType), std::move(identifier));
+    return AST.create<parameterASTnode>(variableType, identifier);
   }
 }
 
-static std::unique_ptr<ASTnode> declParser(){
+ASTnode *Parser::declParser(){
   if(CurTok.type!= INT_TOK && CurTok.type != BOOL_TOK && CurTok.type != FLOAT_TOK && CurTok.type != VOID_TOK){
-    line();printf("ERROR: Missing type in delcaration expected one of 'INT', 'BOOL', 'FLOAT' and 'VOID'");
+    line();report("ERROR: Missing type in delcaration expected one of 'INT', 'BOOL', 'FLOAT' and 'VOID'");
     errorMessage();
   }
   if(CurTok.type == VOID_TOK){
@@ -2024,41 +2465,18 @@ static std::unique_ptr<ASTnode> declParser(){
     if(CurTok.type==VOID_TOK || CurTok.type==INT_TOK || CurTok.type==FLOAT_TOK || CurTok.type==BOOL_TOK || CurTok.type==EOF_TOK){
       return function;
     }
-    line();printf("ERROR: Expected EOF or a declaration");
+    line();report("ERROR: Expected EOF or a declaration");
     errorMessage();
     return nullptr;
   }
   else{
-    TOKEN one = CurTok;
-    getNextToken();
-    TOKEN two = CurTok;
-    getNextToken();
-    TOKEN sc = CurTok;
-    putBackToken(sc);
-    putBackToken(two);
-    putBackToken(one);
-    getNextToken();
-    
-    // printf(CurTok.lexeme.c_str());
-    // getNextToken();
-    // printf("\n");
-    // printf(CurTok.lexeme.c_str());
-    // getNextToken();
-    // printf("\n");
-    // printf(CurTok.lexeme.c_str());
-    // getNextToken();
-    // printf("\n");
-    // printf(CurTok.lexeme.c_str());
-    // getNextToken();
-    // printf("\n");
-
-    CurTok = one;
-    if(sc.type == SC){
+    // var_decl and fun_decl share "type IDENT", the third token decides.
+    if(peekTokenType(2) == SC){
       auto variableDeclaration = variableDeclarationParser();
       if(CurTok.type==VOID_TOK || CurTok.type==INT_TOK || CurTok.type==FLOAT_TOK || CurTok.type==BOOL_TOK || CurTok.type==EOF_TOK){
       return variableDeclaration;
     }
-    line();printf("ERROR: Expected EOF or a declaration");
+    line();report("ERROR: Expected EOF or a declaration");
     errorMessage();
     return nullptr;
     }
@@ -2067,7 +2485,7 @@ static std::unique_ptr<ASTnode> declParser(){
       if(CurTok.type==VOID_TOK || CurTok.type==INT_TOK || CurTok.type==FLOAT_TOK || CurTok.type==BOOL_TOK || CurTok.type==EOF_TOK){
         return functionDeclaration;
       }
-      line();printf("ERROR: Expected EOF or a declaration");
+      line();report("ERROR: Expected EOF or a declaration");
       errorMessage();
       return nullptr;
     }
@@ -2076,19 +2494,19 @@ static std::unique_ptr<ASTnode> declParser(){
 }
 
 
-static std::vector<std::unique_ptr<ASTnode>> EOFparser(){
+std::vector<ASTnode *> Parser::EOFparser(){
   if(CurTok.type != EOF_TOK){
-    line();printf("ERROR: expected end of file after the declarations\n");
+    line();report("ERROR: expected end of file after the declarations\n");
     errorMessage();
-    std::vector<std::unique_ptr<ASTnode>> nullReturner;
+    std::vector<ASTnode *> nullReturner;
     return nullReturner;
   }
 }
 
-static std::vector<std::unique_ptr<ASTnode>> declPrimeParser(){
-  std::vector<std::unique_ptr<ASTnode>> declarations;
+std::vector<ASTnode *> Parser::declPrimeParser(){
+  std::vector<ASTnode *> declarations;
   if(CurTok.type == EOF){
-    std::vector<std::unique_ptr<ASTnode>> nullReturner;
+    std::vector<ASTnode *> nullReturner;
     return nullReturner;
   }
   else if(CurTok.type == INT_TOK || CurTok.type == BOOL_TOK || CurTok.type == FLOAT_TOK){
@@ -2096,12 +2514,12 @@ static std::vector<std::unique_ptr<ASTnode>> declPrimeParser(){
     auto declarationPrime = declPrimeParser();
 
     if(declaration){
-      declarations.push_back(std::move(declaration));
+      declarations.push_back(declaration);
     }
     int size = (int) declarationPrime.size();
     for (size_t i = 0; i < size; i++)
     {
-      declarations.push_back(std::move(declarationPrime[i]));
+      declarations.push_back(declarationPrime[i]);
     }
   }
   
@@ -2112,15 +2530,15 @@ static std::vector<std::unique_ptr<ASTnode>> declPrimeParser(){
 }
 
 
-static std::vector<std::unique_ptr<ASTnode>> declListParser(){
-  std::vector<std::unique_ptr<ASTnode>> declarations;
+std::vector<ASTnode *> Parser::declListParser(){
+  std::vector<ASTnode *> declarations;
 
   if(CurTok.type == EOF || CurTok.type == EOF_TOK) return declarations;
 
   if(CurTok.type!= INT_TOK && CurTok.type != BOOL_TOK && CurTok.type != FLOAT_TOK && CurTok.type != VOID_TOK){
-    line();printf("ERROR: Missing type in delcaration expected one of 'INT', 'BOOL', 'FLOAT' and 'VOID'");
+    line();report("ERROR: Missing type in delcaration expected one of 'INT', 'BOOL', 'FLOAT' and 'VOID'");
     errorMessage();
-    std::vector<std::unique_ptr<ASTnode>> null;
+    std::vector<ASTnode *> null;
     return null;
   }
   auto declaration = declParser();
@@ -2128,12 +2546,12 @@ static std::vector<std::unique_ptr<ASTnode>> declListParser(){
 
 
   if(declaration){
-    declarations.push_back(std::move(declaration));
+    declarations.push_back(declaration);
   }
   int size = (int) declarationPrime.size();
   for (size_t i = 0; i < size; i++)
   {
-    declarations.push_back(std::move(declarationPrime[i]));
+    declarations.push_back(declarationPrime[i]);
   }
   if(CurTok.type == EOF){
     return declarations;
@@ -2141,82 +2559,80 @@ static std::vector<std::unique_ptr<ASTnode>> declListParser(){
   return EOFparser();
 }
 
-static std::unique_ptr<externASTnode> externParser(){
+externASTnode *Parser::externParser(){
   if(CurTok.type == EXTERN){
     getNextToken();
     if(CurTok.type == INT_TOK || CurTok.type == BOOL_TOK || CurTok.type == FLOAT_TOK || CurTok.type == VOID_TOK){
-      auto varighttype = std::make_unique<typeASTnode>(CurTok);
+      auto varighttype = AST.create<typeASTnode>(CurTok);
       getNextToken();
       if(CurTok.type == IDENT){
-        auto ident = std::make_unique<identASTnode>(CurTok, CurTok.lexeme);
+        auto ident = createIdent(CurTok);
         getNextToken();
         if(CurTok.type!= LPAR){
-          line();printf("ERROR: Missing LPAR '(' for function\n");
+          line();report("ERROR: Missing LPAR '(' for function\n");
           errorMessage();
         }
         getNextToken();
         auto parameters = paramsParser();
         if(CurTok.type!= RPAR){
-          line();printf("ERROR: Missing RPAR ')' for function\n");
+          line();report("ERROR: Missing RPAR ')' for function\n");
           errorMessage();
         }
         getNextToken();
         if(CurTok.type!= SC){
-          line();printf("ERROR: Missing SC ';' for function\n");
+          line();report("ERROR: Missing SC ';' for function\n");
           errorMessage();
         }
-        auto returner = std::make_unique<externASTnode>(std::move(varighttype), std::move(ident), std::move(parameters));
+        auto returner = AST.create<externASTnode>(varighttype, ident, AST.copy(parameters));
         getNextToken();
-        return std::move(returner);
+        return returner;
       }
       else{
-        line();printf("ERROR: Missing IDENT for function\n");
+        line();report("ERROR: Missing IDENT for function\n");
         errorMessage();
       }
     }
     else{
-      line();printf("ERROR: Missing function type, expected either INT BOOL FLOAT or VOID ';' for function\n");
+      line();report("ERROR: Missing function type, expected either INT BOOL FLOAT or VOID ';' for function\n");
       errorMessage();
     }
   }
   else{
-    line();printf("ERROR: Missing 'extern'\n");
+    line();report("ERROR: Missing 'extern'\n");
     errorMessage();
     return nullptr;
   }
   return nullptr;
 }
 
-static std::vector<std::unique_ptr<externASTnode>> externListPrimeParser(){
-  std::vector<std::unique_ptr<externASTnode>> externListPrime;
-  std::vector<std::unique_ptr<externASTnode>> returner;
+std::vector<externASTnode *> Parser::externListPrimeParser(){
+  std::vector<externASTnode *> externListPrime;
+  std::vector<externASTnode *> returner;
 
   // printf(CurTok.lexeme.c_str());
   // printf("\n");
-  printf(CurTok.lexeme.c_str());
   if(CurTok.type != EXTERN && CurTok.type != VOID_TOK && CurTok.type != INT_TOK && CurTok.type != FLOAT_TOK && CurTok.type != BOOL_TOK)
   {
-    line();printf("ERROR: Missing 'extern' or a type - INT FLOAT BOOL or VOID\n");
+    line();report("ERROR: Missing 'extern' or a type - INT FLOAT BOOL or VOID\n");
     errorMessage();
     return returner;
   }
-  printf(CurTok.lexeme.c_str());
   if(CurTok.type == EXTERN){
     auto externN = externParser();
     auto externPrimeE = externListPrimeParser();
 
     if(externN){
-      externListPrime.push_back(std::move(externN));
+      externListPrime.push_back(externN);
     }
 
     int size = externPrimeE.size();
 
     for (size_t i = 0; i < size; i++)
     {
-      externListPrime.push_back(std::move(externPrimeE.at(i)));
+      externListPrime.push_back(externPrimeE.at(i));
     }
     if(CurTok.type != VOID_TOK && CurTok.type != INT_TOK && CurTok.type != FLOAT_TOK && CurTok.type != BOOL_TOK){
-      line();printf("ERROR: Missing type - INT FLOAT BOOL or VOID\n");
+      line();report("ERROR: Missing type - INT FLOAT BOOL or VOID\n");
       errorMessage();
       return returner;
     }
@@ -2226,34 +2642,34 @@ static std::vector<std::unique_ptr<externASTnode>> externListPrimeParser(){
 }
 
 
-static std::vector<std::unique_ptr<externASTnode>> externListParser(){
-  std::vector<std::unique_ptr<externASTnode>> externList;
+std::vector<externASTnode *> Parser::externListParser(){
+  std::vector<externASTnode *> externList;
   auto externType = externParser();
   if(externType){
-    externList.push_back(std::move(externType));
+    externList.push_back(externType);
     auto externListPrime = externListPrimeParser();
     int size = (int) externListPrime.size();
     for (size_t i = 0; i < size; i++)
     {
-      externList.push_back(std::move(externListPrime.at(i)));
+      externList.push_back(externListPrime.at(i));
     }
     
   }
   return externList;
 }
 
-static std::vector<std::unique_ptr<ASTnode>> globalsListParser(){
-  std::vector<std::unique_ptr<ASTnode>> globalList;
+std::vector<ASTnode *> Parser::globalsListParser(){
+  std::vector<ASTnode *> globalList;
   if(CurTok.type == EOF || CurTok.type == EOF_TOK) return globalList;
   auto global = declParser();
   auto globalListT = globalsListParser();
   if(global){
-    globalList.push_back(std::move(global));
+    globalList.push_back(global);
   }
   int size = (int) globalListT.size();
   for (size_t i = 0; i < size; i++)
   {
-    globalList.push_back(std::move(globalListT.at(i)));
+    globalList.push_back(globalListT.at(i));
   }
   return globalList;
 }
@@ -2261,7 +2677,7 @@ static std::vector<std::unique_ptr<ASTnode>> globalsListParser(){
 
 
 // program ::= extern_list decl_list
-static std::unique_ptr<ASTnode> parser() {
+ASTnode *Parser::parser() {
   bool externListBool = false;
   auto externlist = nullptr;
   bool declBool = false;
@@ -2275,674 +2691,3710 @@ static std::unique_ptr<ASTnode> parser() {
     auto externlist = externListParser();
     auto declList = globalsListParser();
     if(CurTok.type != EOF_TOK){
-      line();printf("ERROR: EOF expected after decls\n");
+      line();report("ERROR: EOF expected after decls\n");
       errorMessage();
     }
-    return std::make_unique<programASTnode>(std::move(externlist), std::move(declList));
+    return AST.create<programASTnode>(AST.copy(externlist), AST.copy(declList));
     // printf("%s", ex->to_string().c_str());
     // return ex;
   }
   auto declList = globalsListParser();
   if(CurTok.type != EOF_TOK){
-    line();printf("ERROR: EOF expected after decls\n");
+    line();report("ERROR: EOF expected after decls\n");
     errorMessage();
     return nullptr;
   }
-  return std::make_unique<programASTnode>(std::move(declList));
+  return AST.create<programASTnode>(AST.copy(declList));
   // printf("%s", ex->to_string().c_str());
   // return ex;
   
 }
 
 //===----------------------------------------------------------------------===//
-// Code Generation
+// AST Flattening and Summaries
 //===----------------------------------------------------------------------===//
 
-static LLVMContext TheContext;
-static IRBuilder<> Builder(TheContext);
-static std::unique_ptr<Module> TheModule;
-static std::map<std::string, AllocaInst*> NamedValues;
-static std::map<std::string, Value*> GlobalNamedValues;
+// flatten - Append this node (after its children) to F and return its index.
 
-Value *LogErrorV(const char *Str){
-  printf("Code generation error: \n%s\n", Str);
-  return nullptr;
+uint32_t IntASTnode::flatten(FlatAST &F) const {
+  return F.add(NodeKind::IntLit, 0, Val);
 }
 
-Value *IntASTnode::codegen() {
-  return ConstantInt::get(TheContext, APInt(32, Val));
+uint32_t floatASTnode::flatten(FlatAST &F) const {
+  uint32_t Bits;
+  memcpy(&Bits, &Val, sizeof(Bits));
+  return F.add(NodeKind::FloatLit, 0, Bits);
 }
 
-Value *boolASTnode::codegen(){
-  return ConstantInt::get(TheContext, APInt(1, Val));
+uint32_t boolASTnode::flatten(FlatAST &F) const {
+  return F.add(NodeKind::BoolLit, 0, Val);
 }
 
-Value *floatASTnode::codegen(){
-  return ConstantFP::get(TheContext, APFloat(Val));
+uint32_t notAndNegativeASTnode::flatten(FlatAST &F) const {
+  uint32_t Operand = expression->flatten(F);
+  return F.add(NodeKind::Unary, prefix, Operand);
 }
 
-Value *identASTnode::codegen(){
-  Value *val = NamedValues[value];
-  if(val){
-    return Builder.CreateLoad(val, value.c_str());
-  }
-  else{
-    val = TheModule->getNamedValue(value);
-    if(!val){
-      std::string error = "Cannot find declaration of variable '" + value + "'";
-      return LogErrorV(error.c_str());
-    }
-  }
-  return Builder.CreateLoad(val, value.c_str());
+uint32_t identASTnode::flatten(FlatAST &F) const {
+  return F.add(NodeKind::Ident, 0, getSymbol());
 }
 
-Value *expressionASTnode::codegen() {
-  Value *L = left->codegen();
-  Value *R = right->codegen();
-  if(!L || !R){
-    return nullptr;
-  }
-  
-  auto lefttype = L->getType();
-  auto righttype = R->getType();
-
-  if(lefttype != righttype){
-    if(lefttype == Type::getInt32Ty(TheContext)){
-      if(righttype == Type::getInt1Ty(TheContext)) {
-        std::string s = "Cannot execute arithmetic operation -"+operation+"- on integer and boolean";
-        return LogErrorV(s.c_str());
-      }
-      if (righttype == Type::getFloatTy(TheContext)) {
-        L = Builder.CreateSIToFP(L, Type::getFloatTy(TheContext), "converted LHS to type FLOAT");
-      }
-    }
-    else if(lefttype == Type::getFloatTy(TheContext)){
-      if(righttype == Type::getInt1Ty(TheContext)) {
-        std::string s = "Cannot execute arithmetic operation -"+operation+"- on float and boolean";
-        return LogErrorV(s.c_str());
-      }
-      if(righttype == Type::getInt32Ty(TheContext)){
-        R = Builder.CreateSIToFP(R, Type::getFloatTy(TheContext), "converted RHS to type FLOAT");
-      }
-    }
-    else if(lefttype == Type::getInt1Ty(TheContext)){
-      if(righttype == Type::getInt32Ty(TheContext)){
-        std::string s = "Cannot execute arithmetic operation -"+operation+"- on integer and boolean";
-        return LogErrorV(s.c_str());
-      }
-      if(righttype == Type::getFloatTy(TheContext)){
-        std::string s = "Cannot execute arithmetic operation -"+operation+"- on float and boolean";
-        return LogErrorV(s.c_str());
-      }
-    }
-  }
-  lefttype = L->getType();
-  righttype = R->getType();
-  if(lefttype == righttype){
-    if(lefttype == Type::getInt32Ty(TheContext)){
-      if(operation == "+"){
-        return Builder.CreateAdd(L, R, "addtmp");
-      }
-      else if(operation == "-"){
-        return Builder.CreateSub(L, R, "subtmp");
-      }
-      else if(operation == "*"){
-        return Builder.CreateMul(L, R, "multmp");
-      }
-      else if(operation == "/"){
-        return Builder.CreateSDiv(L, R, "dictmp");
-      }
-      else if(operation == "%"){
-        return Builder.CreateSRem(L, R, "remtemp");
-      }
-      else if(operation == "<"){
-        L = Builder.CreateICmpULT(L, R, "cmptemp");
-        return Builder.CreateUIToFP(L, Type::getDoubleTy(TheContext),"booltmp");
-      }
-      else if(operation == ">"){
-        L = Builder.CreateICmpUGT(L, R, "cmptemp");
-        return Builder.CreateUIToFP(L, Type::getDoubleTy(TheContext),"booltmp");
-      }
-      else if(operation == "<="){
-        L = Builder.CreateICmpULE(L, R, "cmptmp");
-        return Builder.CreateUIToFP(L, Type::getDoubleTy(TheContext),"booltmp");
-      }
-      else if(operation == ">="){
-        L = Builder.CreateICmpUGE(L, R, "cmptmp");
-        return Builder.CreateUIToFP(L, Type::getDoubleTy(TheContext),"booltmp");
-      }
-      else if(operation == "=="){
-        Value* LF = Builder.CreateSIToFP(L, Type::getFloatTy(TheContext));
-        Value* RF = Builder.CreateSIToFP(R, Type::getFloatTy(TheContext));
-        L = Builder.CreateFCmpUEQ(LF, RF, "cmptmp");
-        return Builder.CreateUIToFP(L, Type::getDoubleTy(TheContext),"booltmp");
-      }
-      else if(operation == "!="){
-        Value* LF = Builder.CreateSIToFP(L, Type::getFloatTy(TheContext));
-        Value* RF = Builder.CreateSIToFP(R, Type::getFloatTy(TheContext));
-        L = Builder.CreateFCmpUNE(LF, RF, "cmptmp");
-        return Builder.CreateUIToFP(L, Type::getDoubleTy(TheContext),"booltmp");
-      }
-      else if(operation == "&&"){
-        return LogErrorV("AND operation can only be applied to 2 boolean values not ints");
-      }
-      else if(operation == "||"){
-        return LogErrorV("AND operation can only be applied to 2 boolean values not ints");
-      }
-    }
-    else if(lefttype == Type::getFloatTy(TheContext)){
-      if(operation == "+"){
-        return Builder.CreateFAdd(L, R, "addtmp");
-      }
-      else if(operation == "-"){
-        return Builder.CreateFSub(L, R, "subtmp");
-      }
-      else if(operation == "*"){
-        return Builder.CreateFMul(L, R, "multmp");
-      }
-      else if(operation == "/"){
-        return Builder.CreateFDiv(L, R, "dictmp");
-      }
-      else if(operation == "%"){
-        return Builder.CreateFRem(L, R, "remtemp");
-      }
-      else if(operation == "<"){
-        L = Builder.CreateFCmpULT(L, R, "cmptemp");
-        return Builder.CreateUIToFP(L, Type::getDoubleTy(TheContext),"booltmp");
-      }
-      else if(operation == ">"){
-        L = Builder.CreateFCmpUGT(L, R, "cmptemp");
-        return Builder.CreateUIToFP(L, Type::getDoubleTy(TheContext),"booltmp");
-      }
-      else if(operation == "<="){
-        L = Builder.CreateFCmpULE(L, R, "cmptmp");
-        return Builder.CreateUIToFP(L, Type::getDoubleTy(TheContext),"booltmp");
-      }
-      else if(operation == ">="){
-        L = Builder.CreateFCmpUGE(L, R, "cmptmp");
-        return Builder.CreateUIToFP(L, Type::getDoubleTy(TheContext),"booltmp");
-      }
-      else if(operation == "=="){
-        L = Builder.CreateFCmpUEQ(L, R, "cmptmp");
-        return Builder.CreateUIToFP(L, Type::getDoubleTy(TheContext),"booltmp");
-      }
-      else if(operation == "!="){
-        L = Builder.CreateFCmpUNE(L, R, "cmptmp");
-        return Builder.CreateUIToFP(L, Type::getDoubleTy(TheContext),"booltmp");
-      }
-      else if(operation == "&&"){
-        return LogErrorV("AND operation can only be applied to 2 boolean values not floats");
-      }
-      else if(operation == "||"){
-        return LogErrorV("AND operation can only be applied to 2 boolean values not floats");
-      }
-    }
-    else if(lefttype == Type::getInt1Ty(TheContext)){
-      if(operation == "+"){
-        return LogErrorV("Addition operation cannot be applied to 2 boolean values");
-      }
-      else if(operation == "-"){
-        return LogErrorV("Subtraction operation cannot be applied to 2 boolean values");
-      }
-      else if(operation == "*"){
-        return LogErrorV("Multiplication operation cannot be applied to 2 boolean values");
-      }
-      else if(operation == "/"){
-        return LogErrorV("Division operation cannot be applied to 2 boolean values");
-      }
-      else if(operation == "%"){
-        return LogErrorV("Modulo operation cannot be applied to 2 boolean values");
-      }
-      else if(operation == "<"){
-        return LogErrorV("Less than operation cannot be applied to 2 boolean values");
-      }
-      else if(operation == ">"){
-        return LogErrorV("Greater than operation cannot be applied to 2 boolean values");
-      }
-      else if(operation == "<="){
-        return LogErrorV("Less than or equal to operation cannot be applied to 2 boolean values");
-      }
-      else if(operation == ">="){
-        return LogErrorV("Greater than or equal to operation cannot be applied to 2 boolean values");
-      }
-      else if(operation == "=="){
-        return Builder.CreateUIToFP(L, Type::getDoubleTy(TheContext),"booltmp");
-      }
-      else if(operation == "!="){
-        return Builder.CreateUIToFP(L, Type::getDoubleTy(TheContext),"booltmp");
-      }
-      else if(operation == "&&"){
-        L = Builder.CreateAnd(L,R);
-        return Builder.CreateSIToFP(L, Type::getFloatTy(TheContext), "booltmp");
-      }
-      else if(operation == "||"){
-        L = Builder.CreateOr(L,R);
-         return Builder.CreateSIToFP(L, Type::getFloatTy(TheContext), "booltmp");
-      }
-    }
-  }
-  std::string stringy = "Invalid binary operator '" + operation + "'";
-  return LogErrorV(stringy.c_str());
+uint32_t expressionASTnode::flatten(FlatAST &F) const {
+  uint32_t L = left->flatten(F);
+  uint32_t R = right->flatten(F);
+  return F.add(NodeKind::Binary, int16_t(Op), L, R);
 }
 
-Value *functionCall::codegen() {
-  // Value *V = NamedValues[IdentifierStr];
-  // if(!V){
-  //   Value *VV = TheModule->getNamedvalue(IdentifierStr);
-  //   if(!VV){
-  //     std::string returnval = "Variable '" + IdentifierStr +"' is not in current scope";
-  //     return LogErrorV(returnval.c_str());
-  //   }
-  // }
-  Function *callerFunc = TheModule->getFunction(caller);
-  if(callerFunc == nullptr){
-    std::string returnval = "Unknown function '"+name->to_string()+"' referenced";
-    return LogErrorV(returnval.c_str());
-  }
-  if(callerFunc->arg_size() > arguments.size())
-  {
-    std::string returnval = std::to_string(callerFunc->arg_size()-arguments.size()) + " arguments too many passed";
-    return LogErrorV(returnval.c_str());
-  }
-  if(callerFunc->arg_size() < arguments.size())
-  {
-    std::string returnval = std::to_string(arguments.size()-callerFunc->arg_size()) + " missing arguments not passed";
-    return LogErrorV(returnval.c_str());
-  }
+uint32_t functionCall::flatten(FlatAST &F) const {
+  SmallVector<uint32_t, 8> Args;
+  for (ASTnode *Arg : arguments)
+    Args.push_back(Arg->flatten(F));
+  return F.add(NodeKind::Call, 0, caller.symbol, F.addList(Args), Args.size());
+}
 
-  std::vector<Value *> Argss;
-  int size = (int) arguments.size();
-  for (int i = 0; i < size; i++)
-  {
-    Argss.push_back(arguments[i]->codegen());
-    if(!Argss.back()){
-      return nullptr;
-    }
-  }
-  return Builder.CreateCall(callerFunc, Argss, "calltmp");  
+uint32_t assignmentASTnode::flatten(FlatAST &F) const {
+  uint32_t Value = expr->flatten(F);
+  return F.add(NodeKind::Assign, 0, ident->getSymbol(), Value);
 }
 
-Function *externASTnode::codegen(){
-  TOKEN token;
-  int type2;
-  std::vector<Type*> parameterTypes;
+uint32_t returnASTnode::flatten(FlatAST &F) const {
+  uint32_t Value = expression ? expression->flatten(F) : FlatAST::None;
+  return F.add(NodeKind::Return, 0, Value);
+}
 
-  if(parameters.size() >0){
-    //printf("int x\n");
-    for (int i = 0; i < parameters.size(); i++)
-    {
-      type2 = parameters.at(i)->getType();
-      if(type2 == INT_TOK){
-        parameterTypes.push_back(Type::getInt32Ty(TheContext));
-      }
-      else if(type2 == BOOL_TOK){
-        parameterTypes.push_back(Type::getInt1Ty(TheContext));
-      }
-      else if(type2 == FLOAT_TOK){
-        parameterTypes.push_back(Type::getFloatTy(TheContext));
-      }
-      else if(type2 == VOID_TOK){
+uint32_t ifASTnode::flatten(FlatAST &F) const {
+  uint32_t Cond = expr->flatten(F);
+  uint32_t Then = block->flatten(F);
+  uint32_t Else = elseBlock ? elseBlock->flatten(F) : FlatAST::None;
+  return F.add(NodeKind::If, 0, Cond, Then, Else);
+}
 
-      }
-    }
-  }
-  Type* returnt;
-  type2 = type->getType();
-  if(type2 == INT_TOK){
-    returnt = Type::getInt32Ty(TheContext);
-  }
-  else if(type2 == FLOAT_TOK){
-    returnt = Type::getFloatTy(TheContext);
-  }
-  else if(type2 == BOOL_TOK){
-    returnt = Type::getInt1Ty(TheContext);
-  }
-  else if(type2 == VOID_TOK){
-    returnt = Type::getVoidTy(TheContext);
-  }
-  else{
-    return nullptr;
-  }
+uint32_t whileASTnode::flatten(FlatAST &F) const {
+  uint32_t Cond = expr->flatten(F);
+  uint32_t Body = stmt->flatten(F);
+  return F.add(NodeKind::While, 0, Cond, Body);
+}
 
-  FunctionType *FunctionType = FunctionType::get(returnt, parameterTypes, false);
-  Function *F = Function::Create(FunctionType, Function::ExternalLinkage, identifer->to_string(), TheModule.get());
+uint32_t BlockASTnode::flatten(FlatAST &F) const {
+  SmallVector<uint32_t, 16> Children;
+  for (globalASTnode *Decl : declarations)
+    Children.push_back(Decl->flatten(F));
+  for (ASTnode *Stmt : statements)
+    Children.push_back(Stmt->flatten(F));
+  return F.add(NodeKind::Block, 0, F.addList(Children), declarations.size(),
+               statements.size());
+}
 
-  unsigned Idx = 0;
-  for (auto &Arg: F->args()){
-    Arg.setName(parameters.at(Idx)->getName());
-    //printf("\n parameter name %s\n", parameters.at(Idx)->getName().c_str());
-    Idx++;
-  }
+uint32_t globalASTnode::flatten(FlatAST &F) const {
+  return F.add(NodeKind::VarDecl, getType(), ident->getSymbol());
+}
 
-  return F;
+uint32_t parameterASTnode::flatten(FlatAST &F) const {
+  return F.add(NodeKind::Param, type->getType(),
+               identifier ? identifier->getSymbol() : 0);
 }
 
-Value *parameterASTnode::codegen(){
-  if(getType() == INT_TOK){
-    return new GlobalVariable(*TheModule, Type::getInt32Ty(TheContext),false, GlobalValue::CommonLinkage, ConstantInt::get(TheContext, APInt(32,0)), identifier->to_string());
+uint32_t externASTnode::flatten(FlatAST &F) const {
+  SmallVector<uint32_t, 8> Params;
+  for (parameterASTnode *Param : parameters)
+    Params.push_back(Param->flatten(F));
+  return F.add(NodeKind::Extern, type->getType(), identifer->getSymbol(),
+               F.addList(Params), Params.size());
+}
+
+uint32_t functionASTnode::flatten(FlatAST &F) const {
+  uint32_t Proto = function->flatten(F);
+  uint32_t Body = funcBody->flatten(F);
+  return F.add(NodeKind::Function, 0, Proto, Body);
+}
+
+uint32_t programASTnode::flatten(FlatAST &F) const {
+  SmallVector<uint32_t, 64> Children;
+  for (externASTnode *Extern : externList)
+    Children.push_back(Extern->flatten(F));
+  for (ASTnode *Decl : declList)
+    Children.push_back(Decl->flatten(F));
+  return F.add(NodeKind::Program, 0, F.addList(Children), externList.size(),
+               declList.size());
+}
+
+// summarize - Walk the pointer tree through its virtual methods.
+
+void IntASTnode::summarize(ASTSummary &S) const { S.Nodes++; S.Literals++; }
+void floatASTnode::summarize(ASTSummary &S) const { S.Nodes++; S.Literals++; }
+void boolASTnode::summarize(ASTSummary &S) const { S.Nodes++; S.Literals++; }
+
+void notAndNegativeASTnode::summarize(ASTSummary &S) const {
+  S.Nodes++;
+  expression->summarize(S);
+}
+
+void identASTnode::summarize(ASTSummary &S) const {
+  S.Nodes++;
+  S.References++;
+}
+
+void expressionASTnode::summarize(ASTSummary &S) const {
+  S.Nodes++;
+  left->summarize(S);
+  right->summarize(S);
+}
+
+void functionCall::summarize(ASTSummary &S) const {
+  S.Nodes++;
+  S.Calls++;
+  for (ASTnode *Arg : arguments)
+    Arg->summarize(S);
+}
+
+void assignmentASTnode::summarize(ASTSummary &S) const {
+  S.Nodes++;
+  S.References++;
+  expr->summarize(S);
+}
+
+void returnASTnode::summarize(ASTSummary &S) const {
+  S.Nodes++;
+  if (expression)
+    expression->summarize(S);
+}
+
+void ifASTnode::summarize(ASTSummary &S) const {
+  S.Nodes++;
+  expr->summarize(S);
+  block->summarize(S);
+  if (elseBlock)
+    elseBlock->summarize(S);
+}
+
+void whileASTnode::summarize(ASTSummary &S) const {
+  S.Nodes++;
+  expr->summarize(S);
+  stmt->summarize(S);
+}
+
+void BlockASTnode::summarize(ASTSummary &S) const {
+  S.Nodes++;
+  S.Scopes++;
+  for (globalASTnode *Decl : declarations)
+    Decl->summarize(S);
+  for (ASTnode *Stmt : statements)
+    Stmt->summarize(S);
+}
+
+void globalASTnode::summarize(ASTSummary &S) const { S.Nodes++; }
+void parameterASTnode::summarize(ASTSummary &S) const { S.Nodes++; }
+
+void externASTnode::summarize(ASTSummary &S) const {
+  S.Nodes++;
+  for (parameterASTnode *Param : parameters)
+    Param->summarize(S);
+}
+
+void functionASTnode::summarize(ASTSummary &S) const {
+  S.Nodes++;
+  function->summarize(S);
+  funcBody->summarize(S);
+}
+
+void programASTnode::summarize(ASTSummary &S) const {
+  S.Nodes++;
+  for (externASTnode *Extern : externList)
+    Extern->summarize(S);
+  for (ASTnode *Decl : declList)
+    Decl->summarize(S);
+}
+
+/// summarize - The same pass over a FlatAST, as a switch on the node kind.
+static void summarize(const FlatAST &F, uint32_t Id, ASTSummary &S) {
+  if (Id == FlatAST::None)
+    return;
+  const FlatNode &N = F[Id];
+  S.Nodes++;
+  switch (N.Kind) {
+  case NodeKind::IntLit:
+  case NodeKind::FloatLit:
+  case NodeKind::BoolLit:
+    S.Literals++;
+    return;
+  case NodeKind::Ident:
+    S.References++;
+    return;
+  case NodeKind::Unary:
+    summarize(F, N.A, S);
+    return;
+  case NodeKind::Binary:
+  case NodeKind::While:
+  case NodeKind::Function:
+    summarize(F, N.A, S);
+    summarize(F, N.B, S);
+    return;
+  case NodeKind::Call:
+    S.Calls++;
+    for (uint32_t Arg : F.getList(N.B, N.C))
+      summarize(F, Arg, S);
+    return;
+  case NodeKind::Assign:
+    S.References++;
+    summarize(F, N.B, S);
+    return;
+  case NodeKind::Return:
+    summarize(F, N.A, S);
+    return;
+  case NodeKind::If:
+    summarize(F, N.A, S);
+    summarize(F, N.B, S);
+    summarize(F, N.C, S);
+    return;
+  case NodeKind::Block:
+    S.Scopes++;
+    LLVM_FALLTHROUGH;
+  case NodeKind::Program:
+    for (uint32_t Child : F.getList(N.A, N.B + N.C))
+      summarize(F, Child, S);
+    return;
+  case NodeKind::Extern:
+    for (uint32_t Param : F.getList(N.B, N.C))
+      summarize(F, Param, S);
+    return;
+  case NodeKind::VarDecl:
+  case NodeKind::Param:
+    return;
+  }
+  llvm_unreachable("unknown NodeKind");
+}
+
+/// benchmarkTraversal - Time Iterations summarize passes over the pointer tree
+/// and over its flattened copy, and report both on stderr.
+static int benchmarkTraversal(const ASTnode &Root, unsigned Iterations) {
+  using Clock = std::chrono::steady_clock;
+  auto Millis = [](Clock::duration D) {
+    return std::chrono::duration<double, std::milli>(D).count();
+  };
+
+  auto T0 = Clock::now();
+  FlatAST Flat;
+  uint32_t FlatRoot = Root.flatten(Flat);
+  auto T1 = Clock::now();
+
+  ASTSummary TreeSummary, FlatSummary;
+  for (unsigned i = 0; i != Iterations; ++i) {
+    TreeSummary = ASTSummary();
+    Root.summarize(TreeSummary);
+  }
+  auto T2 = Clock::now();
+  for (unsigned i = 0; i != Iterations; ++i) {
+    FlatSummary = ASTSummary();
+    summarize(Flat, FlatRoot, FlatSummary);
+  }
+  auto T3 = Clock::now();
+
+  fprintf(stderr, "nodes: %llu, flat size: %zu bytes\n",
+          (unsigned long long)TreeSummary.Nodes,
+          Flat.Nodes.size() * sizeof(FlatNode) +
+              Flat.Lists.size() * sizeof(uint32_t));
+  fprintf(stderr, "flatten:            %9.3f ms\n", Millis(T1 - T0));
+  fprintf(stderr, "pointer tree x%-5u %9.3f ms\n", Iterations, Millis(T2 - T1));
+  fprintf(stderr, "flat AST     x%-5u %9.3f ms\n", Iterations, Millis(T3 - T2));
+  if (!(TreeSummary == FlatSummary)) {
+    fprintf(stderr, "error: flat AST summary does not match the pointer tree\n");
+    return 1;
+  }
+  return 0;
+}
+
+//===----------------------------------------------------------------------===//
+// Binary operator lowering
+//===----------------------------------------------------------------------===//
+
+// The table has a row for each MiniC type an operator can be applied to.
+static constexpr unsigned NumOperandTypes = unsigned(MiniCType::Bool) + 1;
+
+/// LoweringKind - The shape of the instruction sequence for one entry of the
+/// lowering table.
+enum class LoweringKind : uint8_t {
+  Invalid,        // Sema reports Error
+  Arithmetic,     // Opcode
+  Compare,        // Predicate, giving an i1
+  Logical,        // Opcode (and/or) on i1 operands
+};
+
+struct BinaryLowering {
+  LoweringKind Kind = LoweringKind::Invalid;
+  Instruction::BinaryOps Opcode = Instruction::Add;
+  CmpInst::Predicate Predicate = CmpInst::BAD_ICMP_PREDICATE;
+  bool NoSignedWrap = false; // Signed overflow is undefined, as in C
+  const char *Name = nullptr;
+  const char *Error = nullptr;
+};
+
+/// BinaryLoweringTable - How each binary operator is lowered for each operand
+/// type, built at compile time. Sema checks operators against it and codegen
+/// does one table load per operator.
+struct BinaryLoweringTable {
+  BinaryLowering Entries[NumOperandTypes][NumBinOps] = {};
+
+  constexpr void arithmetic(MiniCType K, BinOp Op,
+                            Instruction::BinaryOps Opcode, const char *Name) {
+    BinaryLowering &E = Entries[unsigned(K)][unsigned(Op)];
+    E.Kind = LoweringKind::Arithmetic;
+    E.Opcode = Opcode;
+    E.NoSignedWrap = Opcode == Instruction::Add || Opcode == Instruction::Sub ||
+                     Opcode == Instruction::Mul;
+    E.Name = Name;
+  }
+
+  constexpr void compare(MiniCType K, BinOp Op, CmpInst::Predicate Predicate,
+                         const char *Name) {
+    BinaryLowering &E = Entries[unsigned(K)][unsigned(Op)];
+    E.Kind = LoweringKind::Compare;
+    E.Predicate = Predicate;
+    E.Name = Name;
+  }
+
+  constexpr void logical(MiniCType K, BinOp Op,
+                         Instruction::BinaryOps Opcode) {
+    BinaryLowering &E = Entries[unsigned(K)][unsigned(Op)];
+    E.Kind = LoweringKind::Logical;
+    E.Opcode = Opcode;
+  }
+
+  constexpr void error(MiniCType K, BinOp Op, const char *Error) {
+    Entries[unsigned(K)][unsigned(Op)].Error = Error;
+  }
+
+  constexpr BinaryLoweringTable() {
+    arithmetic(MiniCType::Int, BinOp::Add, Instruction::Add, "addtmp");
+    arithmetic(MiniCType::Int, BinOp::Sub, Instruction::Sub, "subtmp");
+    arithmetic(MiniCType::Int, BinOp::Mul, Instruction::Mul, "multmp");
+    arithmetic(MiniCType::Int, BinOp::Div, Instruction::SDiv, "dictmp");
+    arithmetic(MiniCType::Int, BinOp::Rem, Instruction::SRem, "remtemp");
+    compare(MiniCType::Int, BinOp::LT, CmpInst::ICMP_SLT, "cmptemp");
+    compare(MiniCType::Int, BinOp::GT, CmpInst::ICMP_SGT, "cmptemp");
+    compare(MiniCType::Int, BinOp::LE, CmpInst::ICMP_SLE, "cmptmp");
+    compare(MiniCType::Int, BinOp::GE, CmpInst::ICMP_SGE, "cmptmp");
+    compare(MiniCType::Int, BinOp::EQ, CmpInst::ICMP_EQ, "cmptmp");
+    compare(MiniCType::Int, BinOp::NE, CmpInst::ICMP_NE, "cmptmp");
+    error(MiniCType::Int, BinOp::And, "AND operation can only be applied to 2 boolean values not ints");
+    error(MiniCType::Int, BinOp::Or, "AND operation can only be applied to 2 boolean values not ints");
+
+    arithmetic(MiniCType::Float, BinOp::Add, Instruction::FAdd, "addtmp");
+    arithmetic(MiniCType::Float, BinOp::Sub, Instruction::FSub, "subtmp");
+    arithmetic(MiniCType::Float, BinOp::Mul, Instruction::FMul, "multmp");
+    arithmetic(MiniCType::Float, BinOp::Div, Instruction::FDiv, "dictmp");
+    arithmetic(MiniCType::Float, BinOp::Rem, Instruction::FRem, "remtemp");
+    compare(MiniCType::Float, BinOp::LT, CmpInst::FCMP_ULT, "cmptemp");
+    compare(MiniCType::Float, BinOp::GT, CmpInst::FCMP_UGT, "cmptemp");
+    compare(MiniCType::Float, BinOp::LE, CmpInst::FCMP_ULE, "cmptmp");
+    compare(MiniCType::Float, BinOp::GE, CmpInst::FCMP_UGE, "cmptmp");
+    compare(MiniCType::Float, BinOp::EQ, CmpInst::FCMP_UEQ, "cmptmp");
+    compare(MiniCType::Float, BinOp::NE, CmpInst::FCMP_UNE, "cmptmp");
+    error(MiniCType::Float, BinOp::And, "AND operation can only be applied to 2 boolean values not floats");
+    error(MiniCType::Float, BinOp::Or, "AND operation can only be applied to 2 boolean values not floats");
+
+    error(MiniCType::Bool, BinOp::Add, "Addition operation cannot be applied to 2 boolean values");
+    error(MiniCType::Bool, BinOp::Sub, "Subtraction operation cannot be applied to 2 boolean values");
+    error(MiniCType::Bool, BinOp::Mul, "Multiplication operation cannot be applied to 2 boolean values");
+    error(MiniCType::Bool, BinOp::Div, "Division operation cannot be applied to 2 boolean values");
+    error(MiniCType::Bool, BinOp::Rem, "Modulo operation cannot be applied to 2 boolean values");
+    error(MiniCType::Bool, BinOp::LT, "Less than operation cannot be applied to 2 boolean values");
+    error(MiniCType::Bool, BinOp::GT, "Greater than operation cannot be applied to 2 boolean values");
+    error(MiniCType::Bool, BinOp::LE, "Less than or equal to operation cannot be applied to 2 boolean values");
+    error(MiniCType::Bool, BinOp::GE, "Greater than or equal to operation cannot be applied to 2 boolean values");
+    compare(MiniCType::Bool, BinOp::EQ, CmpInst::ICMP_EQ, "cmptmp");
+    compare(MiniCType::Bool, BinOp::NE, CmpInst::ICMP_NE, "cmptmp");
+    logical(MiniCType::Bool, BinOp::And, Instruction::And);
+    logical(MiniCType::Bool, BinOp::Or, Instruction::Or);
+  }
+
+  constexpr const BinaryLowering &lookup(MiniCType K, BinOp Op) const {
+    return Entries[unsigned(K)][unsigned(Op)];
+  }
+};
+
+static constexpr BinaryLoweringTable BinaryLowerings;
+
+//===----------------------------------------------------------------------===//
+// Semantic Analysis
+//===----------------------------------------------------------------------===//
+
+/// ScopedSymbolTable - Maps interned symbol ids to their innermost binding.
+/// Bindings live on one stack and each links to the binding of the same symbol
+/// it shadows; a flat open-addressed map holds the innermost binding of each
+/// symbol. Opening a scope records the stack height and closing it unwinds to
+/// it, so a lookup is one hash probe however deeply scopes nest, and a scope
+/// costs only the names it declares.
+template <typename ValueT> class ScopedSymbolTable {
+  enum : unsigned { NoBinding = ~0u };
+
+  struct Entry {
+    unsigned Symbol;
+    unsigned Shadowed; // Index of the binding this one hides, or NoBinding
+    ValueT Value;
+  };
+
+  DenseMap<unsigned, unsigned> Innermost; // Symbol -> index into Bindings
+  std::vector<Entry> Bindings;
+  SmallVector<unsigned, 16> ScopeStarts;
+
+  unsigned scopeStart() const {
+    return ScopeStarts.empty() ? 0 : ScopeStarts.back();
+  }
+
+public:
+  void pushScope() { ScopeStarts.push_back(Bindings.size()); }
+
+  void popScope() {
+    unsigned Start = ScopeStarts.pop_back_val();
+    while (Bindings.size() > Start) {
+      const Entry &E = Bindings.back();
+      Innermost.find(E.Symbol)->second = E.Shadowed;
+      Bindings.pop_back();
+    }
+  }
+
+  /// declare - Bind Symbol in the innermost scope. Returns false, leaving the
+  /// table unchanged, if that scope already declares it.
+  bool declare(unsigned Symbol, const ValueT &Value) {
+    unsigned &Top = Innermost.try_emplace(Symbol, NoBinding).first->second;
+    if (Top != NoBinding && Top >= scopeStart())
+      return false;
+    Bindings.push_back({Symbol, Top, Value});
+    Top = Bindings.size() - 1;
+    return true;
+  }
+
+  /// lookup - The innermost binding of Symbol, or null. The pointer is only
+  /// good until the next declare().
+  const ValueT *lookup(unsigned Symbol) const {
+    auto It = Innermost.find(Symbol);
+    if (It == Innermost.end() || It->second == NoBinding)
+      return nullptr;
+    return &Bindings[It->second].Value;
+  }
+};
+
+/// FunctionCallGraph - For each function, by symbol id, the functions its
+/// body calls.
+using FunctionCallGraph = std::vector<SmallVector<unsigned, 4>>;
+
+/// Sema - Resolves names and checks types between parsing and code generation.
+/// Every identifier and call is checked against its declaration, and every
+/// expression is annotated with its MiniC type and the implicit conversion its
+/// user needs, so codegen is a straight lowering of a tree known to be valid.
+/// Each local variable of a function gets its own slot number, and references
+/// are bound to slots, so codegen never looks a name up.
+class Sema {
+public:
+  /// Binding - What a variable name refers to.
+  struct Binding {
+    ASTnode *Decl;  // globalASTnode or parameterASTnode
+    MiniCType Ty;
+    unsigned Slot;  // NoSlot for a global
+  };
+
+private:
+  const StringInterner &Symbols;
+  ScopedSymbolTable<Binding> Variables;   // Globals are the outermost scope
+  std::vector<externASTnode *> Functions; // Indexed by symbol id
+  std::vector<bool> Defined;              // Indexed by symbol id
+  FunctionCallGraph Calls;                // Indexed by symbol id
+  externASTnode *CurFunction = nullptr;
+  unsigned NumSlots = 0;
+  unsigned ErrorCount = 0;
+
+public:
+  explicit Sema(const StringInterner &Symbols)
+      : Symbols(Symbols), Functions(Symbols.size()), Defined(Symbols.size()),
+        Calls(Symbols.size()) {}
+
+  unsigned getErrorCount() const { return ErrorCount; }
+
+  void error(const Twine &Msg) {
+    printf("Semantic error: \n%s\n", Msg.str().c_str());
+    ErrorCount++;
+  }
+
+  /// convert - Check that E can be used where a To is expected and record the
+  /// implicit conversion that gets it there.
+  bool convert(ASTnode *E, MiniCType To) {
+    MiniCType From = E->getExprType();
+    if (From == MiniCType::Invalid || To == MiniCType::Invalid)
+      return true; // Already reported
+    if (From == To)
+      return true;
+    if (From == MiniCType::Int && To == MiniCType::Float) {
+      E->setConversion(Conversion::IntToFloat);
+      return true;
+    }
+    return false;
+  }
+
+  void declareGlobal(unsigned Symbol, ASTnode *Decl, MiniCType Ty) {
+    if (!Variables.declare(Symbol, {Decl, Ty, NoSlot}))
+      error("Global variable '" + Symbols.getName(Symbol) +
+            "' is already declared");
+  }
+
+  /// declareLocal - Bind Symbol in the innermost scope to a new slot of the
+  /// current function and return the slot.
+  unsigned declareLocal(unsigned Symbol, ASTnode *Decl, MiniCType Ty) {
+    unsigned Slot = NumSlots++;
+    if (!Variables.declare(Symbol, {Decl, Ty, Slot}))
+      error("Variable '" + Symbols.getName(Symbol) +
+            "' is already declared in this scope");
+    return Slot;
+  }
+
+  void pushScope() { Variables.pushScope(); }
+  void popScope() { Variables.popScope(); }
+
+  const Binding *lookup(unsigned Symbol) const {
+    return Variables.lookup(Symbol);
+  }
+
+  bool declareFunction(externASTnode *F);
+  bool defineFunction(externASTnode *F);
+
+  externASTnode *lookupFunction(unsigned Symbol) { return Functions[Symbol]; }
+
+  void beginFunction(externASTnode *F) {
+    CurFunction = F;
+    NumSlots = 0;
+    pushScope();
+  }
+
+  /// endFunction - Close the function's scope and return how many slots its
+  /// locals need.
+  unsigned endFunction() {
+    popScope();
+    return NumSlots;
+  }
+
+  externASTnode *getCurFunction() const { return CurFunction; }
+
+  /// noteCall - Record that the current function calls Callee.
+  void noteCall(unsigned Callee) {
+    SmallVector<unsigned, 4> &Callees = Calls[CurFunction->getSymbol()];
+    if (!is_contained(Callees, Callee))
+      Callees.push_back(Callee);
+  }
+
+  FunctionCallGraph takeCallGraph() { return std::move(Calls); }
+};
+
+/// getParamTypes - The types of F's parameters; a (void) list has none.
+static SmallVector<MiniCType, 8>
+getParamTypes(ArrayRef<parameterASTnode *> Params) {
+  SmallVector<MiniCType, 8> Types;
+  for (parameterASTnode *P : Params)
+    if (P->getType() != VOID_TOK)
+      Types.push_back(getMiniCType(P->getType()));
+  return Types;
+}
+
+bool Sema::declareFunction(externASTnode *F) {
+  externASTnode *&Prev = Functions[F->getSymbol()];
+  if (Prev && (Prev->getType() != F->getType() ||
+               getParamTypes(Prev->getParameters()) !=
+                   getParamTypes(F->getParameters()))) {
+    error("Conflicting declarations of function '" + F->getName() + "'");
+    return false;
+  }
+  if (!Prev)
+    Prev = F;
+  return true;
+}
+
+bool Sema::defineFunction(externASTnode *F) {
+  if (!declareFunction(F))
+    return false;
+  if (Defined[F->getSymbol()]) {
+    error("Function '" + F->getName() + "' cannot be redefined");
+    return false;
+  }
+  Defined[F->getSymbol()] = true;
+  return true;
+}
+
+// Literals are typed when they are created.
+void IntASTnode::analyze(Sema &S) {}
+
+void floatASTnode::analyze(Sema &S) {}
+
+void boolASTnode::analyze(Sema &S) {}
+
+void identASTnode::analyze(Sema &S) {
+  const Sema::Binding *B = S.lookup(getSymbol());
+  if (!B) {
+    S.error("Cannot find declaration of variable '" + getName() + "'");
+    Ty = MiniCType::Invalid;
+    return;
+  }
+  Ty = B->Ty;
+  Slot = B->Slot;
+}
+
+void notAndNegativeASTnode::analyze(Sema &S) {
+  expression->analyze(S);
+  MiniCType Operand = expression->getExprType();
+  Ty = Operand;
+  if (Operand == MiniCType::Invalid)
+    return;
+  if (prefix == '!') {
+    if (S.convert(expression, MiniCType::Bool))
+      return;
+  } else if (Operand == MiniCType::Int || Operand == MiniCType::Float) {
+    return;
+  }
+  S.error(Twine("'") + Twine(prefix) + "' operation cannot be applied to type '" +
+          getTypeName(Operand) + "'");
+  Ty = MiniCType::Invalid;
+}
+
+void expressionASTnode::analyze(Sema &S) {
+  left->analyze(S);
+  right->analyze(S);
+  MiniCType L = left->getExprType();
+  MiniCType R = right->getExprType();
+  Ty = MiniCType::Invalid;
+  if (L == MiniCType::Invalid || R == MiniCType::Invalid)
+    return;
+
+  StringRef operation = getBinOpSpelling(Op);
+  if (L == MiniCType::Void || R == MiniCType::Void) {
+    S.error("Invalid binary operator '" + operation + "' on a void value");
+    return;
+  }
+  if (L != R) {
+    if (L == MiniCType::Bool || R == MiniCType::Bool) {
+      StringRef Other = (L == MiniCType::Int || R == MiniCType::Int) ? "integer" : "float";
+      S.error("Cannot execute arithmetic operation -" + operation + "- on " +
+              Other + " and boolean");
+      return;
+    }
+    OperandTy = MiniCType::Float; // One side is an int, widened to float
+  } else {
+    OperandTy = L;
+  }
+  S.convert(left, OperandTy);
+  S.convert(right, OperandTy);
+
+  const BinaryLowering &E = BinaryLowerings.lookup(OperandTy, Op);
+  if (E.Kind == LoweringKind::Invalid) {
+    S.error(E.Error);
+    return;
+  }
+  Ty = E.Kind == LoweringKind::Arithmetic ? OperandTy : MiniCType::Bool;
+}
+
+void functionCall::analyze(Sema &S) {
+  Ty = MiniCType::Invalid;
+  for (ASTnode *Arg : arguments)
+    Arg->analyze(S);
+
+  StringRef Name = name->getName();
+  externASTnode *Callee = S.lookupFunction(caller.symbol);
+  if (!Callee) {
+    S.error("Unknown function '" + Name + "' referenced");
+    return;
+  }
+  S.noteCall(caller.symbol);
+  SmallVector<MiniCType, 8> Params = getParamTypes(Callee->getParameters());
+  if (Params.size() > arguments.size()) {
+    S.error(Twine(Params.size() - arguments.size()) +
+            " missing arguments not passed to '" + Name + "'");
+    return;
+  }
+  if (Params.size() < arguments.size()) {
+    S.error(Twine(arguments.size() - Params.size()) +
+            " arguments too many passed to '" + Name + "'");
+    return;
+  }
+  for (size_t i = 0; i < Params.size(); i++)
+    if (!S.convert(arguments[i], Params[i]))
+      S.error("Argument " + Twine(i + 1) + " of call to '" + Name +
+              "' has type '" + getTypeName(arguments[i]->getExprType()) +
+              "' but '" + getTypeName(Params[i]) + "' was expected");
+  Ty = getMiniCType(Callee->getType());
+}
+
+void assignmentASTnode::analyze(Sema &S) {
+  expr->analyze(S);
+  const Sema::Binding *B = S.lookup(ident->getSymbol());
+  if (!B) {
+    S.error("Cannot assign variable '" + ident->getName() +
+            "' since it does not exist in the current scope");
+    Ty = MiniCType::Invalid;
+    return;
+  }
+  Ty = B->Ty;
+  ident->bindSlot(B->Slot);
+  if (!S.convert(expr, Ty))
+    S.error(Twine("Cannot assign a value of type '") +
+            getTypeName(expr->getExprType()) + "' to variable '" +
+            ident->getName() + "' of type '" + getTypeName(Ty) + "'");
+}
+
+void returnASTnode::analyze(Sema &S) {
+  externASTnode *F = S.getCurFunction();
+  MiniCType Expected = getMiniCType(F->getType());
+  if (!expression) {
+    if (Expected != MiniCType::Void)
+      S.error("Function '" + F->getName() + "' must return a value of type '" +
+              getTypeName(Expected) + "'");
+    return;
+  }
+  expression->analyze(S);
+  if (Expected == MiniCType::Void)
+    S.error("Cannot return a value from void function '" + F->getName() + "'");
+  else if (!S.convert(expression, Expected))
+    S.error(Twine("Cannot return a value of type '") +
+            getTypeName(expression->getExprType()) + "' from function '" +
+            F->getName() + "' returning '" + getTypeName(Expected) + "'");
+}
+
+/// analyzeCondition - Check the condition of an if or while statement.
+static void analyzeCondition(Sema &S, ASTnode *Cond, StringRef Statement) {
+  Cond->analyze(S);
+  if (!S.convert(Cond, MiniCType::Bool))
+    S.error("Condition of " + Statement + " statement must be of type 'bool' "
+            "not '" + getTypeName(Cond->getExprType()) + "'");
+}
+
+void ifASTnode::analyze(Sema &S) {
+  analyzeCondition(S, expr, "if");
+  block->analyze(S);
+  if (elseBlock)
+    elseBlock->analyze(S);
+}
+
+void whileASTnode::analyze(Sema &S) {
+  analyzeCondition(S, expr, "while");
+  stmt->analyze(S);
+}
+
+void BlockASTnode::analyze(Sema &S) {
+  S.pushScope();
+  for (globalASTnode *Decl : declarations)
+    Decl->analyze(S);
+  for (ASTnode *Statement : statements)
+    Statement->analyze(S);
+  S.popScope();
+}
+
+// A globalASTnode is a local variable declaration, analyzed by its block.
+void globalASTnode::analyze(Sema &S) {
+  Slot = S.declareLocal(get_symbol(), this, getMiniCType(getType()));
+}
+
+// A parameterASTnode in the declaration list is a global variable; function
+// parameters are bound by functionASTnode::analyze.
+void parameterASTnode::analyze(Sema &S) {
+  S.declareGlobal(getSymbol(), this, getMiniCType(getType()));
+}
+
+void externASTnode::analyze(Sema &S) { S.declareFunction(this); }
+
+void functionASTnode::analyze(Sema &S) {
+  if (!S.defineFunction(function))
+    return;
+  S.beginFunction(function);
+  for (parameterASTnode *Param : function->getParameters())
+    if (Param->getType() != VOID_TOK)
+      Param->bindSlot(S.declareLocal(Param->getSymbol(), Param,
+                                     getMiniCType(Param->getType())));
+  funcBody->analyze(S);
+  NumSlots = S.endFunction();
+}
+
+void programASTnode::analyze(Sema &S) {
+  for (externASTnode *Extern : externList)
+    Extern->analyze(S);
+  for (ASTnode *Decl : declList)
+    Decl->analyze(S);
+}
+
+//===----------------------------------------------------------------------===//
+// Constant Folding
+//===----------------------------------------------------------------------===//
+
+/// ASTFolder - Folds constant expressions in a typed AST, with the semantics
+/// codegen gives them, so even unoptimized IR carries no constant arithmetic.
+/// Locals that are assigned exactly once, with a constant, are propagated:
+/// their uses become the constant and the variable disappears. An if or while
+/// whose condition is constant keeps only the branch that can run.
+///
+/// Assignments are counted on one pass over a function and propagated on the
+/// next, and passes repeat until nothing changes, so a use that comes before
+/// its variable's assignment is replaced too: it reads an uninitialized local,
+/// which may as well hold the constant.
+class ASTFolder {
+  static constexpr unsigned Pinned = ~0u; // A parameter, never propagated
+
+  ASTContext &AST;
+  std::vector<unsigned> AssignCounts;     // Indexed by slot, this round
+  std::vector<unsigned> PrevAssignCounts; // Indexed by slot, last round
+  std::vector<ASTnode *> SlotValues;      // Literal of a constant local
+  bool FoundConstant = false;
+
+public:
+  ASTFolder(ASTContext &AST) : AST(AST) {}
+
+  ASTnode *makeLiteral(const ConstantValue &V) {
+    switch (V.Ty) {
+    case MiniCType::Int:
+      return AST.create<IntASTnode>(V.Int);
+    case MiniCType::Float:
+      return AST.create<floatASTnode>(V.Float);
+    default:
+      return AST.create<boolASTnode>(V.Bool);
+    }
+  }
+
+  BlockASTnode *makeEmptyBlock() {
+    return AST.create<BlockASTnode>(None, None);
+  }
+
+  /// foldExpr - Fold the expression E and return the node to use in its
+  /// place. A constant comes back as a literal of the value E's user sees,
+  /// with Sema's implicit conversion already applied.
+  ASTnode *foldExpr(ASTnode *E);
+
+  void beginFunction(unsigned NumSlots) {
+    AssignCounts.assign(NumSlots, 0);
+    PrevAssignCounts.assign(NumSlots, 0);
+    SlotValues.assign(NumSlots, nullptr);
+  }
+
+  void pin(unsigned Slot) { AssignCounts[Slot] = Pinned; }
+
+  /// beginRound / endRound - Bracket one pass over a function body. endRound
+  /// returns true if another pass could fold more: the pass found a new
+  /// constant local, or dropped code and so changed the assignment counts.
+  void beginRound() {
+    FoundConstant = false;
+    for (unsigned &Count : AssignCounts)
+      if (Count != Pinned)
+        Count = 0;
+  }
+
+  bool endRound() {
+    bool Again = FoundConstant || AssignCounts != PrevAssignCounts;
+    PrevAssignCounts = AssignCounts;
+    return Again;
+  }
+
+  /// assigned - Note an assignment of Value (already folded) to the variable
+  /// in Slot, and return Value if the assignment makes it a constant local.
+  ASTnode *assigned(unsigned Slot, ASTnode *Value) {
+    if (Slot == NoSlot || AssignCounts[Slot] == Pinned)
+      return nullptr;
+    AssignCounts[Slot]++;
+    if (PrevAssignCounts[Slot] != 1 || !Value->getConstant())
+      return nullptr;
+    if (!SlotValues[Slot]) {
+      SlotValues[Slot] = Value;
+      FoundConstant = true;
+    }
+    return Value;
+  }
+
+  /// getSlotValue - The literal held by the local in Slot, if it is constant.
+  ASTnode *getSlotValue(unsigned Slot) const {
+    return Slot == NoSlot ? nullptr : SlotValues[Slot];
+  }
+};
+
+/// convertConstant - Apply an implicit conversion to a constant.
+static ConstantValue convertConstant(const ConstantValue &V, Conversion C) {
+  switch (C) {
+  case Conversion::IntToFloat:
+    return ConstantValue::getFloat(float(V.Int));
+  case Conversion::None:
+    break;
+  }
+  return V;
+}
+
+ASTnode *ASTFolder::foldExpr(ASTnode *E) {
+  Conversion C = E->getConversion();
+  ASTnode *Folded = E->fold(*this);
+  if (C == Conversion::None)
+    return Folded;
+  Optional<ConstantValue> V = Folded->getConstant();
+  return V ? makeLiteral(convertConstant(*V, C)) : Folded;
+}
+
+/// evaluatePredicate - Compare two constants the way an icmp or fcmp with
+/// predicate P would.
+static bool evaluatePredicate(CmpInst::Predicate P, const ConstantValue &L,
+                              const ConstantValue &R) {
+  if (CmpInst::isFPPredicate(P)) {
+    // An fcmp predicate is a mask of the outcomes it accepts.
+    unsigned Outcome = L.Float < R.Float    ? CmpInst::FCMP_OLT
+                       : L.Float > R.Float  ? CmpInst::FCMP_OGT
+                       : L.Float == R.Float ? CmpInst::FCMP_OEQ
+                                            : CmpInst::FCMP_UNO;
+    return P & Outcome;
+  }
+  int SL = L.Ty == MiniCType::Bool ? L.Bool : L.Int;
+  int SR = R.Ty == MiniCType::Bool ? R.Bool : R.Int;
+  switch (P) {
+  case CmpInst::ICMP_EQ:
+    return SL == SR;
+  case CmpInst::ICMP_NE:
+    return SL != SR;
+  case CmpInst::ICMP_SGT:
+    return SL > SR;
+  case CmpInst::ICMP_SGE:
+    return SL >= SR;
+  case CmpInst::ICMP_SLT:
+    return SL < SR;
+  case CmpInst::ICMP_SLE:
+    return SL <= SR;
+  default:
+    llvm_unreachable("not an integer predicate");
+  }
+}
+
+/// foldArithmetic - Evaluate an arithmetic instruction on constants, or fail
+/// if it has no defined result (integer division by zero or overflow).
+static Optional<ConstantValue> foldArithmetic(Instruction::BinaryOps Opcode,
+                                              const ConstantValue &L,
+                                              const ConstantValue &R) {
+  // Integer add/sub/mul are nsw: signed overflow is undefined.
+  int Result;
+  switch (Opcode) {
+  case Instruction::Add:
+    if (AddOverflow(L.Int, R.Int, Result))
+      return None;
+    return ConstantValue::getInt(Result);
+  case Instruction::Sub:
+    if (SubOverflow(L.Int, R.Int, Result))
+      return None;
+    return ConstantValue::getInt(Result);
+  case Instruction::Mul:
+    if (MulOverflow(L.Int, R.Int, Result))
+      return None;
+    return ConstantValue::getInt(Result);
+  case Instruction::SDiv:
+  case Instruction::SRem:
+    if (R.Int == 0 || (L.Int == std::numeric_limits<int>::min() && R.Int == -1))
+      return None;
+    return ConstantValue::getInt(Opcode == Instruction::SDiv ? L.Int / R.Int
+                                                             : L.Int % R.Int);
+  case Instruction::FAdd:
+    return ConstantValue::getFloat(L.Float + R.Float);
+  case Instruction::FSub:
+    return ConstantValue::getFloat(L.Float - R.Float);
+  case Instruction::FMul:
+    return ConstantValue::getFloat(L.Float * R.Float);
+  case Instruction::FDiv:
+    return ConstantValue::getFloat(L.Float / R.Float);
+  case Instruction::FRem:
+    return ConstantValue::getFloat(std::fmod(L.Float, R.Float));
+  default:
+    llvm_unreachable("not an arithmetic opcode");
+  }
+}
+
+ASTnode *IntASTnode::fold(ASTFolder &F) { return this; }
+
+ASTnode *floatASTnode::fold(ASTFolder &F) { return this; }
+
+ASTnode *boolASTnode::fold(ASTFolder &F) { return this; }
+
+ASTnode *identASTnode::fold(ASTFolder &F) {
+  ASTnode *Value = F.getSlotValue(Slot);
+  return Value ? Value : this;
+}
+
+ASTnode *notAndNegativeASTnode::fold(ASTFolder &F) {
+  expression = F.foldExpr(expression);
+  Optional<ConstantValue> V = expression->getConstant();
+  if (!V)
+    return this;
+  if (prefix == '!')
+    return F.makeLiteral(ConstantValue::getBool(!V->Bool));
+  if (Ty == MiniCType::Float)
+    return F.makeLiteral(ConstantValue::getFloat(-V->Float));
+  // Negating INT_MIN overflows, which nsw makes undefined.
+  if (V->Int == std::numeric_limits<int>::min())
+    return this;
+  return F.makeLiteral(ConstantValue::getInt(-V->Int));
+}
+
+ASTnode *expressionASTnode::fold(ASTFolder &F) {
+  left = F.foldExpr(left);
+  right = F.foldExpr(right);
+  Optional<ConstantValue> L = left->getConstant();
+  Optional<ConstantValue> R = right->getConstant();
+  const BinaryLowering &E = BinaryLowerings.lookup(OperandTy, Op);
+
+  // A constant left operand of && or || either decides the result or leaves
+  // it to the right operand, which is only evaluated in that case.
+  if (L && E.Kind == LoweringKind::Logical) {
+    bool IsAnd = E.Opcode == Instruction::And;
+    return L->Bool == IsAnd ? right : F.makeLiteral(*L);
+  }
+  if (!L || !R)
+    return this;
+
+  switch (E.Kind) {
+  case LoweringKind::Invalid:
+  case LoweringKind::Logical: // Decided by the left operand above
+    break;
+  case LoweringKind::Arithmetic:
+    if (Optional<ConstantValue> V = foldArithmetic(E.Opcode, *L, *R))
+      return F.makeLiteral(*V);
+    return this;
+  case LoweringKind::Compare:
+    return F.makeLiteral(
+        ConstantValue::getBool(evaluatePredicate(E.Predicate, *L, *R)));
+  }
+  llvm_unreachable("operator rejected by Sema or already folded");
+}
+
+ASTnode *functionCall::fold(ASTFolder &F) {
+  for (ASTnode *&Arg : arguments)
+    Arg = F.foldExpr(Arg);
+  return this;
+}
+
+ASTnode *assignmentASTnode::fold(ASTFolder &F) {
+  expr = F.foldExpr(expr);
+  // A constant local's one assignment is just its value.
+  if (ASTnode *Value = F.assigned(ident->getSlot(), expr))
+    return Value;
+  return this;
+}
+
+ASTnode *returnASTnode::fold(ASTFolder &F) {
+  if (expression)
+    expression = F.foldExpr(expression);
+  return this;
+}
+
+ASTnode *ifASTnode::fold(ASTFolder &F) {
+  expr = F.foldExpr(expr);
+  if (Optional<ConstantValue> Cond = expr->getConstant()) {
+    if (Cond->Bool)
+      return block->fold(F);
+    return elseBlock ? elseBlock->fold(F) : nullptr;
+  }
+  block->fold(F);
+  if (elseBlock)
+    elseBlock->fold(F);
+  return this;
+}
+
+ASTnode *whileASTnode::fold(ASTFolder &F) {
+  expr = F.foldExpr(expr);
+  Optional<ConstantValue> Cond = expr->getConstant();
+  if (Cond && !Cond->Bool)
+    return nullptr;
+  stmt = stmt->fold(F);
+  if (!stmt || stmt->getConstant())
+    stmt = F.makeEmptyBlock();
+  return this;
+}
+
+ASTnode *BlockASTnode::fold(ASTFolder &F) {
+  size_t Kept = 0;
+  for (ASTnode *Statement : statements) {
+    Statement = Statement->fold(F);
+    // A statement that folded to a value has no effect.
+    if (Statement && !Statement->getConstant())
+      statements[Kept++] = Statement;
+  }
+  statements = statements.take_front(Kept);
+  for (globalASTnode *Decl : declarations)
+    Decl->fold(F);
+  return this;
+}
+
+ASTnode *globalASTnode::fold(ASTFolder &F) {
+  Propagated = F.getSlotValue(Slot) != nullptr;
+  return this;
+}
+
+ASTnode *parameterASTnode::fold(ASTFolder &F) { return this; }
+
+ASTnode *externASTnode::fold(ASTFolder &F) { return this; }
+
+ASTnode *functionASTnode::fold(ASTFolder &F) {
+  F.beginFunction(NumSlots);
+  for (parameterASTnode *Param : function->getParameters())
+    if (Param->getType() != VOID_TOK)
+      F.pin(Param->getSlot());
+  do
+    F.beginRound();
+  while (funcBody->fold(F), F.endRound());
+  return this;
+}
+
+ASTnode *programASTnode::fold(ASTFolder &F) {
+  for (ASTnode *Decl : declList)
+    Decl->fold(F);
+  return this;
+}
+
+//===----------------------------------------------------------------------===//
+// Optimization
+//===----------------------------------------------------------------------===//
+
+/// createHostTargetMachine - A TargetMachine for the host triple, which gives
+/// the module its data layout, the optimizer its cost model (TTI) and the
+/// backend its instruction selection. CPU "native" (or empty) means the host
+/// CPU with the features it reports; any other CPU gets its default features.
+/// Attrs ("+avx2", "-fma", ...) are applied last.
+static std::unique_ptr<TargetMachine>
+createHostTargetMachine(unsigned OptLevel, StringRef CPU,
+                        ArrayRef<std::string> Attrs, std::string &Error) {
+  std::string TripleName = sys::getDefaultTargetTriple();
+  const Target *T = TargetRegistry::lookupTarget(TripleName, Error);
+  if (!T)
+    return nullptr;
+
+  SubtargetFeatures Features;
+  if (CPU.empty() || CPU == "native") {
+    CPU = sys::getHostCPUName();
+    StringMap<bool> HostFeatures;
+    if (sys::getHostCPUFeatures(HostFeatures))
+      for (auto &Feature : HostFeatures)
+        Features.AddFeature(Feature.first(), Feature.second);
+  } else {
+    std::unique_ptr<MCSubtargetInfo> STI(
+        T->createMCSubtargetInfo(TripleName, "", ""));
+    if (!STI->isCPUStringValid(CPU)) {
+      Error = ("unknown CPU '" + CPU + "' for " + TripleName).str();
+      return nullptr;
+    }
+  }
+  for (const std::string &Attr : Attrs)
+    Features.AddFeature(Attr);
+
+  return std::unique_ptr<TargetMachine>(T->createTargetMachine(
+      TripleName, CPU, Features.getString(), TargetOptions(), Reloc::PIC_,
+      None, static_cast<CodeGenOpt::Level>(OptLevel)));
+}
+
+/// Optimizer - Runs LLVM's new pass manager pipelines over generated code:
+/// optionally a custom pipeline on each function as soon as it is generated,
+/// then the standard -O1/-O2/-O3 pipeline over the whole module.
+class Optimizer {
+  unsigned OptLevel;
+  LoopAnalysisManager LAM;
+  FunctionAnalysisManager FAM;
+  CGSCCAnalysisManager CGAM;
+  ModuleAnalysisManager MAM;
+  PassBuilder PB;
+  FunctionPassManager FunctionPipeline;
+  bool HasFunctionPipeline = false;
+  bool TimeFunctionPipeline = false;
+
+  /// getTuningOptions - Vectorize at -O2 and above, as clang does.
+  static PipelineTuningOptions getTuningOptions(unsigned OptLevel) {
+    PipelineTuningOptions PTO;
+    PTO.LoopVectorization = OptLevel > 1;
+    PTO.SLPVectorization = OptLevel > 1;
+    return PTO;
+  }
+
+  PassBuilder::OptimizationLevel getPassBuilderLevel() const {
+    switch (OptLevel) {
+    case 0:
+      return PassBuilder::OptimizationLevel::O0;
+    case 1:
+      return PassBuilder::OptimizationLevel::O1;
+    case 2:
+      return PassBuilder::OptimizationLevel::O2;
+    default:
+      return PassBuilder::OptimizationLevel::O3;
+    }
+  }
+
+public:
+  Optimizer(TargetMachine &TM, unsigned OptLevel)
+      : OptLevel(OptLevel),
+        PB(/*DebugLogging=*/false, &TM, getTuningOptions(OptLevel)) {
+    PB.registerModuleAnalyses(MAM);
+    PB.registerCGSCCAnalyses(CGAM);
+    PB.registerFunctionAnalyses(FAM);
+    PB.registerLoopAnalyses(LAM);
+    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+  }
+
+  /// setFunctionPipeline - Parse a textual function pipeline, in opt's
+  /// -passes syntax, to run on each function as it is generated. If Time,
+  /// the time it takes is reported on exit. It is part of the code
+  /// generation phase of --time-phases, so it has a report of its own rather
+  /// than a line in that one, which would count it twice.
+  Error setFunctionPipeline(StringRef Pipeline, bool Time) {
+    HasFunctionPipeline = true;
+    TimeFunctionPipeline = Time;
+    return PB.parsePassPipeline(FunctionPipeline, Pipeline);
+  }
+
+  void runOnFunction(Function &F) {
+    if (!HasFunctionPipeline)
+      return;
+    NamedRegionTimer T("function-passes", "Function passes",
+                       "mccomp-function-passes",
+                       "MiniC --function-passes, part of code generation",
+                       TimeFunctionPipeline);
+    FunctionPipeline.run(F, FAM);
+  }
+
+  /// runOnModule - Run the pipeline for the optimization level over M. Ahead
+  /// of a ThinLTO link that is the pre-link pipeline, which leaves the late
+  /// loop optimizations to the link, where they see the inlined code.
+  void runOnModule(Module &M, bool ThinLTOPreLink = false) {
+    if (OptLevel == 0)
+      return; // Nothing to do beyond the frontend's constant folding
+    ModulePassManager MPM =
+        ThinLTOPreLink
+            ? PB.buildThinLTOPreLinkDefaultPipeline(getPassBuilderLevel())
+            : PB.buildPerModuleDefaultPipeline(getPassBuilderLevel());
+    MPM.run(M, MAM);
+  }
+
+  /// getModuleSummary - The ThinLTO summary of M: its functions, their calls
+  /// and references, which a ThinLTO link reads instead of the whole module.
+  ModuleSummaryIndex &getModuleSummary(Module &M) {
+    return MAM.getResult<ModuleSummaryIndexAnalysis>(M);
+  }
+};
+
+//===----------------------------------------------------------------------===//
+// Output
+//===----------------------------------------------------------------------===//
+
+/// OutputKind - What mccomp writes for the module.
+enum class OutputKind { IR, Bitcode, Assembly, Object };
+
+static StringRef getDefaultOutputFilename(OutputKind Kind) {
+  switch (Kind) {
+  case OutputKind::IR:
+    return "output.ll";
+  case OutputKind::Bitcode:
+    return "output.bc";
+  case OutputKind::Assembly:
+    return "output.s";
+  case OutputKind::Object:
+    return "output.o";
+  }
+  llvm_unreachable("unknown output kind");
+}
+
+/// emitModule - Write M to Filename as IR, bitcode, or, through TM's backend,
+/// assembly or an object file. Bitcode carries Summary, if given, for ThinLTO.
+/// Returns false after reporting an error.
+static bool emitModule(Module &M, TargetMachine &TM, OutputKind Kind,
+                       StringRef Filename,
+                       const ModuleSummaryIndex *Summary = nullptr) {
+  bool IsText = Kind == OutputKind::IR || Kind == OutputKind::Assembly;
+  std::error_code EC;
+  raw_fd_ostream Out(Filename, EC, IsText ? sys::fs::OF_Text : sys::fs::OF_None);
+  if (EC) {
+    errs() << "Could not open file '" << Filename << "': " << EC.message() << "\n";
+    return false;
+  }
+
+  switch (Kind) {
+  case OutputKind::IR:
+    M.print(Out, nullptr);
+    return true;
+  case OutputKind::Bitcode:
+    // ThinLTO identifies modules by the hash stored with the summary.
+    WriteBitcodeToFile(M, Out, /*ShouldPreserveUseListOrder=*/false, Summary,
+                       /*GenerateHash=*/Summary != nullptr);
+    return true;
+  case OutputKind::Assembly:
+  case OutputKind::Object: {
+    legacy::PassManager CodeGenPasses;
+    CodeGenFileType FileType =
+        Kind == OutputKind::Object ? CGFT_ObjectFile : CGFT_AssemblyFile;
+    if (TM.addPassesToEmitFile(CodeGenPasses, Out, nullptr, FileType)) {
+      errs() << "The target cannot emit a file of this type\n";
+      return false;
+    }
+    CodeGenPasses.run(M);
+    return true;
+  }
+  }
+  llvm_unreachable("unknown output kind");
+}
+
+/// benchmarkModuleIO - Time Iterations round trips of M through textual IR and
+/// through bitcode, each written to and parsed back from memory, and report
+/// both on stderr.
+static int benchmarkModuleIO(const Module &M, unsigned Iterations) {
+  using Clock = std::chrono::steady_clock;
+  auto Millis = [](Clock::duration D) {
+    return std::chrono::duration<double, std::milli>(D).count();
+  };
+
+  std::string Text;
+  SmallVector<char, 0> Bitcode;
+  Clock::duration TextWrite{}, TextRead{}, BitcodeWrite{}, BitcodeRead{};
+  for (unsigned i = 0; i != Iterations; ++i) {
+    auto T0 = Clock::now();
+    Text.clear();
+    raw_string_ostream TextOut(Text);
+    M.print(TextOut, nullptr);
+    TextOut.flush();
+    auto T1 = Clock::now();
+    {
+      LLVMContext Context;
+      SMDiagnostic Err;
+      if (!parseAssemblyString(Text, Err, Context)) {
+        Err.print("mccomp", errs());
+        return 1;
+      }
+    }
+    auto T2 = Clock::now();
+    Bitcode.clear();
+    raw_svector_ostream BitcodeOut(Bitcode);
+    WriteBitcodeToFile(M, BitcodeOut);
+    auto T3 = Clock::now();
+    {
+      LLVMContext Context;
+      MemoryBufferRef Buffer(StringRef(Bitcode.data(), Bitcode.size()), "bench");
+      Expected<std::unique_ptr<Module>> Parsed = parseBitcodeFile(Buffer, Context);
+      if (!Parsed) {
+        errs() << toString(Parsed.takeError()) << "\n";
+        return 1;
+      }
+    }
+    auto T4 = Clock::now();
+    TextWrite += T1 - T0;
+    TextRead += T2 - T1;
+    BitcodeWrite += T3 - T2;
+    BitcodeRead += T4 - T3;
+  }
+
+  fprintf(stderr, "functions: %zu\n", M.size());
+  fprintf(stderr, "           %12s %12s %12s\n", "bytes", "write ms", "load ms");
+  fprintf(stderr, "text IR    %12zu %12.3f %12.3f\n", Text.size(),
+          Millis(TextWrite) / Iterations, Millis(TextRead) / Iterations);
+  fprintf(stderr, "bitcode    %12zu %12.3f %12.3f\n", Bitcode.size(),
+          Millis(BitcodeWrite) / Iterations, Millis(BitcodeRead) / Iterations);
+  return 0;
+}
+
+//===----------------------------------------------------------------------===//
+// JIT Execution
+//===----------------------------------------------------------------------===//
+
+// The runtime --run links programs against, which behaves like the one in
+// the test drivers. Other extern functions are looked up in mccomp's own
+// process, so the C library is available too.
+static int runtimePrintInt(int X) {
+  fprintf(stderr, "%d\n", X);
+  return 0;
+}
+
+static float runtimePrintFloat(float X) {
+  fprintf(stderr, "%f\n", X);
+  return 0;
+}
+
+static const char *RunWrapperName = "mccomp.run";
+
+/// getJITTargetMachineBuilder - Describe TM's target, CPU, features and
+/// optimization level, for the JIT to create target machines of its own.
+static orc::JITTargetMachineBuilder
+getJITTargetMachineBuilder(TargetMachine &TM) {
+  orc::JITTargetMachineBuilder JTMB(TM.getTargetTriple());
+  JTMB.setCPU(TM.getTargetCPU().str())
+      .addFeatures(SubtargetFeatures(TM.getTargetFeatureString()).getFeatures())
+      .setCodeGenOptLevel(TM.getOptLevel());
+  return JTMB;
+}
+
+/// JITObjectCache - Keeps the machine code the JIT compiles in a directory,
+/// so that a later run of the same code loads it instead of optimizing and
+/// compiling it again. An object is filed under a hash of the IR it is
+/// compiled from (in a lazy JIT, one function's) and of everything else that
+/// shapes the code: the target, CPU, features, optimization level and LLVM
+/// version. Files are named llvmcache-<hash>, the names pruneCache looks
+/// after, so the directory can be kept to a size by evicting the objects
+/// used least recently. A cache entry that cannot be read or is not an
+/// object is deleted and its code compiled again; one that cannot be written
+/// is dropped. Either only costs time.
+class JITObjectCache : public ObjectCache {
+  std::string Dir;
+  std::string TargetKey;
+  std::mutex Lock;
+  StringMap<std::unique_ptr<MemoryBuffer>> Loaded; // Guarded by Lock
+
+  /// getPath - Where M's object is kept, or "" if M has no key.
+  std::string getPath(const Module &M) const {
+    StringRef Key = M.getModuleIdentifier();
+    return Key.startswith("llvmcache-") ? (Dir + "/" + Key).str() : "";
+  }
+
+  /// load - Read the object at Path, or return null if there is none that
+  /// can be used.
+  static std::unique_ptr<MemoryBuffer> load(const std::string &Path);
+
+public:
+  JITObjectCache(StringRef Dir, TargetMachine &TM)
+      : Dir(Dir.str()),
+        TargetKey((TM.getTargetTriple().str() + "/" + TM.getTargetCPU() +
+                   "/" + TM.getTargetFeatureString() + "/O" +
+                   Twine(TM.getOptLevel()) + "/" LLVM_VERSION_STRING)
+                      .str()) {}
+
+  /// assignKey - Name M after its key and return whether its object is in
+  /// the cache. If it is, the object is read now and held for getObject, so
+  /// that it cannot go missing in between, as the unoptimized M would then
+  /// be compiled in its place.
+  bool assignKey(Module &M);
+
+  void notifyObjectCompiled(const Module *M, MemoryBufferRef Obj) override;
+  std::unique_ptr<MemoryBuffer> getObject(const Module *M) override;
+
+  /// prune - Evict objects until the cache holds no more than MaxBytes.
+  void prune(uint64_t MaxBytes) {
+    CachePruningPolicy Policy;
+    Policy.Interval = std::chrono::seconds(0); // On every run
+    Policy.MaxSizeBytes = MaxBytes;
+    pruneCache(Dir, Policy);
+  }
+};
+
+std::unique_ptr<MemoryBuffer> JITObjectCache::load(const std::string &Path) {
+  Expected<sys::fs::file_t> FD = sys::fs::openNativeFileForRead(Path);
+  if (!FD) {
+    consumeError(FD.takeError());
+    return nullptr;
+  }
+  // Eviction goes by access time, which many file systems update lazily or
+  // not at all, so set it.
+  sys::fs::setLastAccessAndModificationTime(*FD, sys::toTimePoint(time(nullptr)));
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Obj = MemoryBuffer::getOpenFile(
+      *FD, Path, /*FileSize=*/-1, /*RequiresNullTerminator=*/false);
+  sys::fs::closeFile(*FD);
+  if (!Obj)
+    return nullptr;
+  Expected<std::unique_ptr<object::ObjectFile>> File =
+      object::ObjectFile::createObjectFile((*Obj)->getMemBufferRef());
+  if (!File) {
+    consumeError(File.takeError());
+    sys::fs::remove(Path);
+    return nullptr;
+  }
+  return std::move(*Obj);
+}
+
+bool JITObjectCache::assignKey(Module &M) {
+  SmallVector<char, 0> Buffer;
+  raw_svector_ostream OS(Buffer);
+  WriteBitcodeToFile(M, OS);
+  OS << TargetKey;
+  std::array<uint8_t, 20> Hash = SHA1::hash(arrayRefFromStringRef(OS.str()));
+  M.setModuleIdentifier("llvmcache-" + toHex(Hash, /*LowerCase=*/true));
+  std::unique_ptr<MemoryBuffer> Obj = load(getPath(M));
+  if (!Obj)
+    return false;
+  std::lock_guard<std::mutex> Guard(Lock);
+  Loaded[M.getModuleIdentifier()] = std::move(Obj);
+  return true;
+}
+
+void JITObjectCache::notifyObjectCompiled(const Module *M,
+                                          MemoryBufferRef Obj) {
+  std::string Path = getPath(*M);
+  if (Path.empty())
+    return;
+  // Write a temporary file and rename it, so that no run ever reads half an
+  // object.
+  Expected<sys::fs::TempFile> Temp =
+      sys::fs::TempFile::create(Dir + "/tmp-%%%%%%%%.o");
+  if (!Temp) {
+    consumeError(Temp.takeError());
+    return;
+  }
+  bool Failed;
+  {
+    raw_fd_ostream Out(Temp->FD, /*shouldClose=*/false);
+    Out << Obj.getBuffer();
+    Out.flush();
+    Failed = Out.has_error();
+    Out.clear_error(); // Or its destructor reports it as fatal
+  }
+  if (Failed) {
+    consumeError(Temp->discard());
+    return;
+  }
+  if (Error Err = Temp->keep(Path))
+    consumeError(std::move(Err));
+}
+
+std::unique_ptr<MemoryBuffer> JITObjectCache::getObject(const Module *M) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  auto It = Loaded.find(M->getModuleIdentifier());
+  if (It == Loaded.end())
+    return nullptr;
+  std::unique_ptr<MemoryBuffer> Obj = std::move(It->second);
+  Loaded.erase(It);
+  return Obj;
+}
+
+/// JITOptions - How --run compiles the program.
+struct JITOptions {
+  bool Lazy = true;                // A function at a time, when first called
+  unsigned NumThreads = 0;         // Compile threads, besides the caller's
+  JITObjectCache *Cache = nullptr; // Where compiled code is kept, if anywhere
+};
+
+/// compileOneRequested - Partition a lazily compiled module one function at a
+/// time, even when several are wanted at once; the lazy JIT puts the rest
+/// back and partitions again straight away. Functions compiled together
+/// would share a module, and so a cache key that depends on which functions
+/// happened to be wanted at the same moment, and one thread.
+static Optional<orc::CompileOnDemandLayer::GlobalValueSet>
+compileOneRequested(orc::CompileOnDemandLayer::GlobalValueSet Requested) {
+  if (Requested.size() <= 1)
+    return Requested;
+  return orc::CompileOnDemandLayer::GlobalValueSet{*Requested.begin()};
+}
+
+/// reportLazyCompileFailure - Called instead of a lazily compiled function
+/// whose body could not be compiled; the JIT has reported why. Compile
+/// threads may still be running, so leave without running destructors.
+static void reportLazyCompileFailure() {
+  fflush(stdout);
+  errs() << "JIT compilation failed\n";
+  std::_Exit(1);
+}
+
+/// createJIT - A JIT that generates code as JTMB describes, on Opts's
+/// threads (none: on the thread that needs the code), through Opts's cache,
+/// with the MiniC runtime and the symbols of the host process available to
+/// the code it compiles. Modules added lazily are compiled a function at a
+/// time, when the function is first called.
+static Expected<std::unique_ptr<orc::LLLazyJIT>>
+createJIT(orc::JITTargetMachineBuilder JTMB, const JITOptions &Opts) {
+  // The compilers LLJIT would pick, but consulting the cache.
+  ObjectCache *Cache = Opts.Cache;
+  bool Concurrent = Opts.NumThreads > 0;
+  auto CreateCompiler = [Cache, Concurrent](orc::JITTargetMachineBuilder JTMB)
+      -> Expected<std::unique_ptr<orc::IRCompileLayer::IRCompiler>> {
+    if (Concurrent)
+      return std::make_unique<orc::ConcurrentIRCompiler>(std::move(JTMB),
+                                                         Cache);
+    Expected<std::unique_ptr<TargetMachine>> TM = JTMB.createTargetMachine();
+    if (!TM)
+      return TM.takeError();
+    return std::make_unique<orc::TMOwningSimpleCompiler>(std::move(*TM),
+                                                         Cache);
+  };
+  Expected<std::unique_ptr<orc::LLLazyJIT>> J =
+      orc::LLLazyJITBuilder()
+          .setJITTargetMachineBuilder(std::move(JTMB))
+          .setNumCompileThreads(Opts.NumThreads)
+          .setCompileFunctionCreator(CreateCompiler)
+          .setLazyCompileFailureAddr(
+              pointerToJITTargetAddress(&reportLazyCompileFailure))
+          .create();
+  if (!J)
+    return J.takeError();
+  (*J)->setPartitionFunction(compileOneRequested);
+  // With compile threads the lazy JIT would copy the whole module to a new
+  // context before splitting it, which costs as much as the module is big.
+  // Splitting it where it is takes the shared context's lock only while a
+  // function is copied out into a context of its own (see compileForRun),
+  // and nothing else uses the context.
+  (*J)->getCompileOnDemandLayer().setCloneToNewContextOnEmit(false);
+
+  orc::JITDylib &JD = (*J)->getMainJITDylib();
+  orc::SymbolMap Runtime;
+  Runtime[(*J)->mangleAndIntern("print_int")] = JITEvaluatedSymbol(
+      pointerToJITTargetAddress(&runtimePrintInt), JITSymbolFlags::Exported);
+  Runtime[(*J)->mangleAndIntern("print_float")] = JITEvaluatedSymbol(
+      pointerToJITTargetAddress(&runtimePrintFloat), JITSymbolFlags::Exported);
+  if (Error Err = JD.define(orc::absoluteSymbols(std::move(Runtime))))
+    return std::move(Err);
+
+  auto Host = orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+      (*J)->getDataLayout().getGlobalPrefix());
+  if (!Host)
+    return Host.takeError();
+  JD.addGenerator(std::move(*Host));
+  return J;
+}
+
+/// parseRunArgument - The constant of type Ty that Arg spells, or null if it
+/// does not spell one.
+static Constant *parseRunArgument(StringRef Arg, Type *Ty) {
+  if (Ty->isIntegerTy(1)) {
+    if (Arg == "true" || Arg == "1")
+      return ConstantInt::getTrue(Ty);
+    if (Arg == "false" || Arg == "0")
+      return ConstantInt::getFalse(Ty);
+    return nullptr;
+  }
+  if (Ty->isIntegerTy()) {
+    int Value;
+    if (Arg.getAsInteger(10, Value))
+      return nullptr;
+    return ConstantInt::get(Ty, Value, /*isSigned=*/true);
+  }
+  std::string Text = Arg.str();
+  char *End;
+  float Value = strtof(Text.c_str(), &End);
+  if (Text.empty() || *End)
+    return nullptr;
+  return ConstantFP::get(Ty, Value);
+}
+
+/// parseRunArguments - Parse Args, the arguments of a call to Name, as
+/// constants of the types in ParamTys and add them to Values. Returns false
+/// after reporting an error.
+static bool parseRunArguments(StringRef Name, ArrayRef<Type *> ParamTys,
+                              ArrayRef<std::string> Args,
+                              SmallVectorImpl<Constant *> &Values) {
+  if (Args.size() != ParamTys.size()) {
+    errs() << "Function '" << Name << "' takes " << ParamTys.size()
+           << " arguments but " << Args.size() << " were given\n";
+    return false;
+  }
+  for (unsigned i = 0; i != Args.size(); ++i) {
+    Constant *C = parseRunArgument(Args[i], ParamTys[i]);
+    if (!C) {
+      errs() << "Invalid value '" << Args[i] << "' for argument " << i + 1
+             << " of '" << Name << "'\n";
+      return false;
+    }
+    Values.push_back(C);
+  }
+  return true;
+}
+
+/// addRunWrapper - Add a function to M that calls F with the arguments in
+/// an array of eight-byte slots, which it takes a pointer to. An int or bool
+/// argument is read as an int32_t and a float as a float from the start of
+/// its slot. A bool result is returned as an int. The wrapper is the same
+/// whatever the arguments, so its code can be cached.
+static void addRunWrapper(Module &M, Function &F) {
+  LLVMContext &Ctx = M.getContext();
+  FunctionType *FT = F.getFunctionType();
+  Type *Int32Ty = Type::getInt32Ty(Ctx);
+  Type *SlotTy = Type::getInt64Ty(Ctx);
+  Type *RetTy = FT->getReturnType();
+  Type *WrapperRetTy = RetTy->isIntegerTy(1) ? Int32Ty : RetTy;
+  Function *Wrapper = Function::Create(
+      FunctionType::get(WrapperRetTy, {SlotTy->getPointerTo()}, false),
+      Function::ExternalLinkage, RunWrapperName, M);
+  IRBuilder<> B(BasicBlock::Create(Ctx, "entry", Wrapper));
+  SmallVector<Value *, 8> Values;
+  for (unsigned i = 0; i != FT->getNumParams(); ++i) {
+    Type *ParamTy = FT->getParamType(i);
+    Type *LoadTy = ParamTy->isIntegerTy(1) ? Int32Ty : ParamTy;
+    Value *Slot = B.CreateConstGEP1_32(SlotTy, Wrapper->getArg(0), i);
+    Value *Arg =
+        B.CreateLoad(LoadTy, B.CreateBitCast(Slot, LoadTy->getPointerTo()));
+    Values.push_back(B.CreateTrunc(Arg, ParamTy));
+  }
+  Value *Result = B.CreateCall(&F, Values);
+  if (RetTy->isVoidTy())
+    B.CreateRetVoid();
+  else
+    B.CreateRet(B.CreateZExt(Result, WrapperRetTy));
+}
+
+/// CallSpeculator - Guesses that a function being compiled is about to run,
+/// and so will call its callees, and compiles them in the background. The
+/// callees come from Sema's call graph. Compiling a callee makes the guess
+/// about its own callees in turn, so the functions reachable from the first
+/// one called are compiled nearest first, while the program runs, and the
+/// rest of the module never is.
+class CallSpeculator {
+  orc::LLLazyJIT &J;
+  StringMap<std::vector<std::string>> Callees;
+  std::mutex Lock;
+  orc::JITDylib *ImplJD = nullptr; // Guarded by Lock
+  orc::SymbolNameSet Requested;    // Guarded by Lock
+
+public:
+  CallSpeculator(orc::LLLazyJIT &J, const FunctionCallGraph &Calls,
+                 const StringInterner &Symbols)
+      : J(J) {
+    for (unsigned Caller = 0; Caller != Calls.size(); ++Caller)
+      for (unsigned Callee : Calls[Caller])
+        Callees[Symbols.getName(Caller)].push_back(
+            Symbols.getName(Callee).str());
+  }
+
+  /// compiling - Note that the function Caller is being compiled.
+  void compiling(StringRef Caller);
+};
+
+void CallSpeculator::compiling(StringRef Caller) {
+  auto It = Callees.find(Caller);
+  if (It == Callees.end())
+    return;
+  orc::ExecutionSession &ES = J.getExecutionSession();
+  orc::SymbolLookupSet Bodies;
+  orc::JITDylib *BodiesJD;
+  {
+    std::lock_guard<std::mutex> Guard(Lock);
+    // The lazy JIT keeps function bodies in a JITDylib of their own, which
+    // it creates when the module is first looked at.
+    if (!ImplJD)
+      ImplJD = ES.getJITDylibByName(J.getMainJITDylib().getName() + ".impl");
+    if (!ImplJD)
+      return;
+    BodiesJD = ImplJD;
+    for (const std::string &Callee : It->second) {
+      orc::SymbolStringPtr Name = J.mangleAndIntern(Callee);
+      // Externs have no body here; a weak reference lets them be missing.
+      if (Requested.insert(Name).second)
+        Bodies.add(Name, orc::SymbolLookupFlags::WeaklyReferencedSymbol);
+    }
+  }
+  if (Bodies.empty())
+    return;
+  // Asking for the bodies compiles them on the JIT's threads. Nothing waits
+  // for the answer; a call that gets there first waits as usual.
+  ES.lookup(orc::LookupKind::Static,
+            orc::makeJITDylibSearchOrder(
+                BodiesJD, orc::JITDylibLookupFlags::MatchAllSymbols),
+            std::move(Bodies), orc::SymbolState::Ready,
+            [&ES](Expected<orc::SymbolMap> Result) {
+              if (!Result)
+                ES.reportError(Result.takeError());
+            },
+            orc::NoDependenciesToRegister);
+}
+
+/// compileForRun - Create the JIT J for TM, add M to it, and compile the
+/// wrapper added by addRunWrapper, returning its address in Wrapper. M is
+/// optimized as it is compiled, unless its code is in Opts.Cache. If
+/// Opts.Lazy, M's functions are optimized and compiled as they are first
+/// called instead, with their likely callees, from Calls, compiled
+/// speculatively if there are threads to do it. Symbols names the functions
+/// in Calls.
+static Error compileForRun(TargetMachine &TM, orc::ThreadSafeModule M,
+                           const JITOptions &Opts,
+                           const FunctionCallGraph &Calls,
+                           const StringInterner &Symbols,
+                           std::unique_ptr<orc::LLLazyJIT> &J,
+                           JITTargetAddress &Wrapper) {
+  orc::JITTargetMachineBuilder JTMB = getJITTargetMachineBuilder(TM);
+  Expected<std::unique_ptr<orc::LLLazyJIT>> JIT = createJIT(JTMB, Opts);
+  if (!JIT)
+    return JIT.takeError();
+  J = std::move(*JIT);
+  LLVMContext *Shared = M.getContext().getContext();
+  orc::SymbolLookupSet Externs;
+  M.withModuleDo([&](Module &Mod) {
+    for (Function &F : Mod)
+      if (F.isDeclaration() && !F.isIntrinsic())
+        Externs.add(J->mangleAndIntern(F.getName()));
+  });
+  if (Error Err = Opts.Lazy ? J->addLazyIRModule(std::move(M))
+                            : J->addIRModule(std::move(M)))
+    return Err;
+
+  // Speculating without threads would compile everything up front.
+  std::shared_ptr<CallSpeculator> Speculator;
+  if (Opts.Lazy && Opts.NumThreads)
+    Speculator = std::make_shared<CallSpeculator>(*J, Calls, Symbols);
+  // Each module the JIT is about to compile (lazily, one function) is
+  // keyed for the cache by its unoptimized IR and, unless its code is
+  // cached, optimized, with a target machine of its own as threads share
+  // none. Optimizing and compiling hold the module's context lock, so a
+  // function must not be left in the context the whole program shares, or
+  // the threads would take turns.
+  J->getIRTransformLayer().setTransform(
+      [JTMB, Speculator, Opts, Shared](
+          orc::ThreadSafeModule TSM,
+          orc::MaterializationResponsibility &R) mutable
+      -> Expected<orc::ThreadSafeModule> {
+        if (Opts.Lazy && TSM.getContext().getContext() == Shared)
+          TSM = orc::cloneToNewContext(TSM);
+        if (Error Err = TSM.withModuleDo([&](Module &Part) -> Error {
+              if (Speculator)
+                for (Function &F : Part)
+                  if (!F.isDeclaration())
+                    Speculator->compiling(F.getName());
+              if (Opts.Cache && Opts.Cache->assignKey(Part))
+                return Error::success();
+              Expected<std::unique_ptr<TargetMachine>> PartTM =
+                  JTMB.createTargetMachine();
+              if (!PartTM)
+                return PartTM.takeError();
+              Optimizer(**PartTM, (*PartTM)->getOptLevel()).runOnModule(Part);
+              return Error::success();
+            }))
+          return std::move(Err);
+        return std::move(TSM);
+      });
+  // Resolve the externs up front, so that a missing one is reported here
+  // in every mode, not when a lazily compiled caller first runs.
+  if (!Externs.empty()) {
+    Expected<orc::SymbolMap> Found = J->getExecutionSession().lookup(
+        orc::makeJITDylibSearchOrder(&J->getMainJITDylib()), Externs);
+    if (!Found)
+      return Found.takeError();
+  }
+  Expected<JITEvaluatedSymbol> Sym = J->lookup(RunWrapperName);
+  if (!Sym)
+    return Sym.takeError();
+  Wrapper = Sym->getAddress();
+  return Error::success();
+}
+
+/// printRunResult - Print the result of a call to Name, which returns a
+/// RetTy: Float if it is a float and otherwise Int.
+static void printRunResult(StringRef Name, Type *RetTy, int Int, float Float) {
+  if (RetTy->isVoidTy())
+    printf("%s returned\n", Name.str().c_str());
+  else if (RetTy->isFloatTy())
+    printf("%s returned %f\n", Name.str().c_str(), Float);
+  else if (RetTy->isIntegerTy(1))
+    printf("%s returned %s\n", Name.str().c_str(), Int ? "true" : "false");
+  else
+    printf("%s returned %d\n", Name.str().c_str(), Int);
+}
+
+/// callRunWrapper - Call the wrapper at Addr for the function Name, which
+/// returns a RetTy, with the argument slots Args, and print the result.
+static void callRunWrapper(JITTargetAddress Addr, Type *RetTy, StringRef Name,
+                           uint64_t *Args) {
+  if (RetTy->isVoidTy()) {
+    jitTargetAddressToFunction<void (*)(uint64_t *)>(Addr)(Args);
+    printRunResult(Name, RetTy, 0, 0);
+  } else if (RetTy->isFloatTy()) {
+    auto *Wrapper = jitTargetAddressToFunction<float (*)(uint64_t *)>(Addr);
+    printRunResult(Name, RetTy, 0, Wrapper(Args));
+  } else {
+    auto *Wrapper = jitTargetAddressToFunction<int (*)(uint64_t *)>(Addr);
+    printRunResult(Name, RetTy, Wrapper(Args), 0);
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Code Generation
+//===----------------------------------------------------------------------===//
+
+// The context is shareable so that --run can hand the module to the JIT.
+static orc::ThreadSafeContext TheTSC(std::make_unique<LLVMContext>());
+static LLVMContext &TheContext = *TheTSC.getContext();
+static IRBuilder<> Builder(TheContext);
+static std::unique_ptr<Module> TheModule;
+static Optimizer *TheOptimizer; // Runs the per-function pipeline, if any
+static std::vector<AllocaInst*> LocalSlots; // Indexed by Sema's slot number
+static std::vector<Value*> GlobalNamedValues; // Indexed by symbol id
+static std::vector<Function*> FunctionValues; // Indexed by symbol id
+
+/// prepareCodegen - Get ready to generate a program whose names are interned
+/// in Symbols.
+static void prepareCodegen(const StringInterner &Symbols) {
+  GlobalNamedValues.assign(Symbols.size(), nullptr);
+  FunctionValues.assign(Symbols.size(), nullptr);
+}
+
+static Type *getLLVMType(MiniCType Ty) {
+  switch (Ty) {
+  case MiniCType::Int:
+    return Type::getInt32Ty(TheContext);
+  case MiniCType::Float:
+    return Type::getFloatTy(TheContext);
+  case MiniCType::Bool:
+    return Type::getInt1Ty(TheContext);
+  default:
+    return Type::getVoidTy(TheContext);
+  }
+}
+
+Value *IntASTnode::codegen() {
+  return ConstantInt::get(TheContext, APInt(32, Val));
+}
+
+Value *boolASTnode::codegen(){
+  return ConstantInt::get(TheContext, APInt(1, Val));
+}
+
+Value *floatASTnode::codegen(){
+  return ConstantFP::get(TheContext, APFloat(Val));
+}
+
+/// emitValue - Generate the expression E and apply the implicit conversion
+/// Sema attached to it.
+static Value *emitValue(ASTnode *E) {
+  Value *V = E->codegen();
+  switch (E->getConversion()) {
+  case Conversion::None:
+    return V;
+  case Conversion::IntToFloat:
+    return Builder.CreateSIToFP(V, Type::getFloatTy(TheContext), "tofloat");
+  }
+  llvm_unreachable("unknown conversion");
+}
+
+/// emitBranchIfOpen - Branch to Dest unless the current block already ends in
+/// a return.
+static void emitBranchIfOpen(BasicBlock *Dest) {
+  if (!Builder.GetInsertBlock()->getTerminator())
+    Builder.CreateBr(Dest);
+}
+
+/// getVariable - The storage of the variable in Slot, or of the global Symbol.
+static Value *getVariable(unsigned Slot, unsigned Symbol) {
+  if (Slot != NoSlot)
+    return LocalSlots[Slot];
+  return GlobalNamedValues[Symbol];
+}
+
+Value *identASTnode::codegen(){
+  Value *val = getVariable(Slot, getSymbol());
+  return Builder.CreateLoad(val, getName());
+}
+
+/// MaxSpeculatedCost - The most expensive right-hand side of && or || that is
+/// evaluated unconditionally rather than behind a branch. Both sides are then
+/// combined with a select, which costs less than a branch the processor may
+/// mispredict. A select, unlike a bitwise and/or, ignores the right side when
+/// the left decides the result, so poison from an overflow that the program
+/// would never have evaluated does not leak into it.
+static constexpr unsigned MaxSpeculatedCost = 4;
+
+unsigned notAndNegativeASTnode::getSpeculationCost() const {
+  unsigned Cost = expression->getSpeculationCost();
+  return Cost == NotSpeculatable ? Cost : Cost + 1;
+}
+
+unsigned expressionASTnode::getSpeculationCost() const {
+  // Integer division by zero is undefined, so it may only run if the program
+  // would run it.
+  if (OperandTy == MiniCType::Int && (Op == BinOp::Div || Op == BinOp::Rem))
+    return NotSpeculatable;
+  unsigned L = left->getSpeculationCost();
+  unsigned R = right->getSpeculationCost();
+  if (L == NotSpeculatable || R == NotSpeculatable)
+    return NotSpeculatable;
+  return L + R + 1;
+}
+
+/// emitShortCircuit - Generate LHS && RHS or LHS || RHS, evaluating RHS only
+/// if LHS does not decide the result.
+static Value *emitShortCircuit(ASTnode *LHS, ASTnode *RHS, bool IsAnd) {
+  Value *L = emitValue(LHS);
+  BasicBlock *LHSBlock = Builder.GetInsertBlock();
+  Function *function = LHSBlock->getParent();
+
+  BasicBlock *RHSBlock = BasicBlock::Create(TheContext, "logical rhs", function);
+  BasicBlock *mergeBB = BasicBlock::Create(TheContext, "after logical");
+  if (IsAnd)
+    Builder.CreateCondBr(L, RHSBlock, mergeBB);
+  else
+    Builder.CreateCondBr(L, mergeBB, RHSBlock);
+
+  Builder.SetInsertPoint(RHSBlock);
+  Value *R = emitValue(RHS);
+  RHSBlock = Builder.GetInsertBlock(); // RHS may have branched itself
+  Builder.CreateBr(mergeBB);
+
+  function->getBasicBlockList().push_back(mergeBB);
+  Builder.SetInsertPoint(mergeBB);
+  PHINode *Result = Builder.CreatePHI(Type::getInt1Ty(TheContext), 2,
+                                      IsAnd ? "andtmp" : "ortmp");
+  Result->addIncoming(ConstantInt::get(TheContext, APInt(1, !IsAnd)), LHSBlock);
+  Result->addIncoming(R, RHSBlock);
+  return Result;
+}
+
+Value *expressionASTnode::codegen() {
+  const BinaryLowering &E = BinaryLowerings.lookup(OperandTy, Op);
+  if (E.Kind == LoweringKind::Logical &&
+      right->getSpeculationCost() > MaxSpeculatedCost)
+    return emitShortCircuit(left, right, E.Opcode == Instruction::And);
+
+  Value *L = emitValue(left);
+  Value *R = emitValue(right);
+
+  switch(E.Kind){
+  case LoweringKind::Invalid:
+    break;
+  case LoweringKind::Arithmetic: {
+    Value *V = Builder.CreateBinOp(E.Opcode, L, R, E.Name);
+    if (auto *I = dyn_cast<BinaryOperator>(V))
+      I->setHasNoSignedWrap(E.NoSignedWrap);
+    return V;
+  }
+  case LoweringKind::Compare:
+    return Builder.CreateCmp(E.Predicate, L, R, E.Name);
+  case LoweringKind::Logical:
+    return E.Opcode == Instruction::And
+               ? Builder.CreateLogicalAnd(L, R, "andtmp")
+               : Builder.CreateLogicalOr(L, R, "ortmp");
+  }
+  llvm_unreachable("operator rejected by Sema");
+}
+
+Value *functionCall::codegen() {
+  Function *callerFunc = FunctionValues[caller.symbol];
+  std::vector<Value *> Argss;
+  for (ASTnode *Arg : arguments)
+    Argss.push_back(emitValue(Arg));
+  // Void values cannot be named
+  return Builder.CreateCall(callerFunc, Argss, Ty == MiniCType::Void ? "" : "calltmp");
+}
+
+Function *externASTnode::codegen(){
+  std::vector<Type*> parameterTypes;
+  for (MiniCType ParamTy : getParamTypes(parameters))
+    parameterTypes.push_back(getLLVMType(ParamTy));
+  Type *returnt = getLLVMType(getMiniCType(type->getType()));
+
+  FunctionType *FunctionType = FunctionType::get(returnt, parameterTypes, false);
+  Function *F = Function::Create(FunctionType, Function::ExternalLinkage, getName(), TheModule.get());
+  FunctionValues[getSymbol()] = F;
+
+  unsigned Idx = 0;
+  for (auto &Arg: F->args()){
+    Arg.setName(parameters[Idx]->getName());
+    Idx++;
+  }
+
+  return F;
+}
+
+Value *parameterASTnode::codegen(){
+  Type *type = getLLVMType(getMiniCType(getType()));
+  GlobalVariable *global = new GlobalVariable(*TheModule, type, false, GlobalValue::CommonLinkage, Constant::getNullValue(type), getName());
+  GlobalNamedValues[getSymbol()] = global;
+  return global;
+}
+
+
+Function *functionASTnode::codegen(){
+  Function *f = FunctionValues[function->getSymbol()];
+  if(!f) f = function->codegen();
+
+  BasicBlock *basicblock = BasicBlock::Create(TheContext, "block", f);
+  Builder.SetInsertPoint(basicblock);
+
+
+  LocalSlots.assign(NumSlots, nullptr);
+  for (auto &argument : f->args()){
+    IRBuilder<> Tmp(&f->getEntryBlock(), f->getEntryBlock().begin());
+    AllocaInst *Alloca = Tmp.CreateAlloca(argument.getType(), 0, argument.getName());
+    Builder.CreateStore(&argument, Alloca);
+    LocalSlots[function->getParameter(argument.getArgNo())->getSlot()] = Alloca;
+  }
+
+  funcBody->codegen();
+
+  // Falling off the end of the body returns nothing, or zero from a function
+  // with a result.
+  if (!Builder.GetInsertBlock()->getTerminator()) {
+    Type *returnType = f->getReturnType();
+    if (returnType->isVoidTy())
+      Builder.CreateRetVoid();
+    else
+      Builder.CreateRet(Constant::getNullValue(returnType));
+  }
+
+  verifyFunction(*f);
+  if (TheOptimizer)
+    TheOptimizer->runOnFunction(*f);
+
+  return f;
+}
+
+Value *assignmentASTnode::codegen(){
+  Value *value = emitValue(expr);
+  Value *variableName = getVariable(ident->getSlot(), ident->getSymbol());
+  Builder.CreateStore(value, variableName);
+  return value;
+}
+
+Value *globalASTnode::codegen(){
+  GlobalVariable *global = nullptr;
+  if(type->getType() == INT_TOK){
+    global = new GlobalVariable(*TheModule, Type::getInt32Ty(TheContext), false, GlobalValue::CommonLinkage, ConstantInt::get(TheContext, APInt(32,0)), ident->getName());
+  }
+  else if (type->getType() == BOOL_TOK){
+    global = new GlobalVariable(*TheModule, Type::getInt1Ty(TheContext), false, GlobalValue::CommonLinkage, ConstantInt::get(TheContext, APInt(1,0)), ident->getName());
+  }  
+  else if (type->getType() == FLOAT_TOK){
+    global = new GlobalVariable(*TheModule, Type::getFloatTy(TheContext), false, GlobalValue::CommonLinkage, ConstantFP::get(TheContext, APFloat((float)0)), ident->getName());
+  }
+  if(global) GlobalNamedValues[get_symbol()] = global;
+  return global;
+}
+
+Value *returnASTnode::codegen() {
+  if(expression){
+    return Builder.CreateRet(emitValue(expression));
+  }
+  return Builder.CreateRetVoid();
+}
+
+Value *ifASTnode::codegen(){
+  Value *condition = emitValue(expr);
+
+  Function *function = Builder.GetInsertBlock()->getParent();
+
+  BasicBlock *then = BasicBlock::Create(TheContext, "then", function);
+  BasicBlock *mergeBB = BasicBlock::Create(TheContext, "after if block");
+  if(!elseBlock){
+    Builder.CreateCondBr(condition, then, mergeBB);
+    Builder.SetInsertPoint(then);
+    block->codegen();
+    emitBranchIfOpen(mergeBB);
+  }
+  else{
+    BasicBlock *elseBB = BasicBlock::Create(TheContext, "else bock");
+    Builder.CreateCondBr(condition, then, elseBB);
+    Builder.SetInsertPoint(then);
+    block->codegen();
+    emitBranchIfOpen(mergeBB);
+
+    function->getBasicBlockList().push_back(elseBB);
+    Builder.SetInsertPoint(elseBB);
+    elseBlock->codegen();
+    emitBranchIfOpen(mergeBB);
+  }
+  function->getBasicBlockList().push_back(mergeBB);
+  Builder.SetInsertPoint(mergeBB);
+  return nullptr;
+}
+
+Value *whileASTnode::codegen(){
+  Function *func = Builder.GetInsertBlock()->getParent();
+  BasicBlock *condition = BasicBlock::Create(TheContext, "condition", func);
+  BasicBlock *loop = BasicBlock::Create(TheContext, "while loop", func);
+  BasicBlock *afterLoop = BasicBlock::Create(TheContext, "after loop", func);
+
+  Builder.CreateBr(condition);
+  Builder.SetInsertPoint(condition);
+
+  Value *endCond = emitValue(expr);
+  Builder.CreateCondBr(endCond, loop, afterLoop);
+  Builder.SetInsertPoint(loop);
+
+  stmt->codegen();
+  emitBranchIfOpen(condition);
+  Builder.SetInsertPoint(afterLoop);
+  return nullptr;
+}
+
+Value *notAndNegativeASTnode::codegen(){
+  Value *value = emitValue(expression);
+
+  if(prefix == '!'){
+    return Builder.CreateNot(value, "not temp");
   }
-  else if(getType() == BOOL_TOK){
-    return new GlobalVariable(*TheModule, Type::getInt1Ty(TheContext),false, GlobalValue::CommonLinkage, ConstantInt::get(TheContext, APInt(1,0)), identifier->to_string());
+  if(Ty == MiniCType::Int){
+    return Builder.CreateNSWNeg(value, "neg temp");
+  }
+  return Builder.CreateFNeg(value, "neg temp");
+}
+
+Value *BlockASTnode::codegen(){
+  Function *func = Builder.GetInsertBlock()->getParent();
+  for (globalASTnode *declaration : declarations)
+  {
+    if (declaration->isPropagated())
+      continue;
+    Type *type = getLLVMType(getMiniCType(declaration->getType()));
+    IRBuilder<> Tmp(&func->getEntryBlock(), func->getEntryBlock().begin());
+    LocalSlots[declaration->getSlot()] = Tmp.CreateAlloca(type, 0, declaration->get_name());
   }
-  else if(getType() == FLOAT_TOK){
-    return new GlobalVariable(*TheModule, Type::getFloatTy(TheContext),false, GlobalValue::CommonLinkage, ConstantFP::get(TheContext, APFloat(0.0)), identifier->to_string());
+
+  for (ASTnode *statement : statements)
+  {
+    // Anything after a return is unreachable.
+    if (Builder.GetInsertBlock()->getTerminator())
+      break;
+    statement->codegen();
   }
+
   return nullptr;
 }
 
 
-Function *functionASTnode::codegen(){
-  Function *f = TheModule -> getFunction(function->getName());
 
-  if(!f) f = function->codegen();
-  if (!f) return nullptr;
+Value *programASTnode::codegen(){
+  Value *declarations;
+  int size = externList.size();
+  for (size_t i = 0; i < size; i++)
+  {
+    externList[i]->codegen();
+  }
+  int size2 = declList.size();
+  for (size_t i = 0; i < size2; i++)
+  {
+    declarations = declList[i]->codegen();
+  }
+  return declarations;
+}
+
+
+
+//===----------------------------------------------------------------------===//
+// Bytecode Interpreter
+//===----------------------------------------------------------------------===//
+
+// --run --interpret skips LLVM: the typed AST is compiled to a register
+// bytecode in one pass and run by an interpreter loop, so a program starts in
+// microseconds rather than the milliseconds code generation takes.
+//
+// Each function has a frame of registers: its slots (parameters first, then
+// locals, numbered by Sema), then its constants, then temporaries, which are
+// allocated as a stack. Operands and results are registers, so a + b is one
+// instruction. A call passes its arguments in the caller's topmost
+// temporaries, and the callee's frame begins there, so nothing is copied.
+
+/// Register operands of an opcode, as a mask. The other operands are a
+/// function, global or jump target.
+enum : uint8_t { RegA = 1, RegB = 2, RegC = 4 };
+
+// BYTECODE_OPCODES - Every opcode and its register operands. Int arithmetic
+// wraps, and compares give 0 or 1. Float compares are true when the operands
+// are unordered, as codegen's fcmp predicates are.
+#define BYTECODE_OPCODES(X)                                                    \
+  X(Mov, RegA | RegB)             /* A = B */                                  \
+  X(IntToFloat, RegA | RegB)      /* A = (float)B */                           \
+  X(AddI, RegA | RegB | RegC)     /* A = B + C */                              \
+  X(SubI, RegA | RegB | RegC)                                                  \
+  X(MulI, RegA | RegB | RegC)                                                  \
+  X(DivI, RegA | RegB | RegC)                                                  \
+  X(RemI, RegA | RegB | RegC)                                                  \
+  X(AddF, RegA | RegB | RegC)                                                  \
+  X(SubF, RegA | RegB | RegC)                                                  \
+  X(MulF, RegA | RegB | RegC)                                                  \
+  X(DivF, RegA | RegB | RegC)                                                  \
+  X(RemF, RegA | RegB | RegC)                                                  \
+  X(NegI, RegA | RegB)            /* A = -B */                                 \
+  X(NegF, RegA | RegB)                                                         \
+  X(Not, RegA | RegB)             /* A = !B */                                 \
+  X(And, RegA | RegB | RegC)      /* A = B & C, on bools */                    \
+  X(Or, RegA | RegB | RegC)                                                    \
+  X(LtI, RegA | RegB | RegC)      /* A = B < C */                              \
+  X(GtI, RegA | RegB | RegC)                                                   \
+  X(LeI, RegA | RegB | RegC)                                                   \
+  X(GeI, RegA | RegB | RegC)                                                   \
+  X(EqI, RegA | RegB | RegC)                                                   \
+  X(NeI, RegA | RegB | RegC)                                                   \
+  X(LtF, RegA | RegB | RegC)                                                   \
+  X(GtF, RegA | RegB | RegC)                                                   \
+  X(LeF, RegA | RegB | RegC)                                                   \
+  X(GeF, RegA | RegB | RegC)                                                   \
+  X(EqF, RegA | RegB | RegC)                                                   \
+  X(NeF, RegA | RegB | RegC)                                                   \
+  X(GetGlobal, RegA)              /* A = global B */                           \
+  X(SetGlobal, RegB)              /* global A = B */                           \
+  X(Jump, 0)                      /* Go to C */                                \
+  X(JumpIf, RegA)                 /* If A, go to C */                          \
+  X(JumpIfNot, RegA)                                                           \
+  X(JLtI, RegA | RegB)            /* If A < B, go to C */                      \
+  X(JGtI, RegA | RegB)                                                         \
+  X(JLeI, RegA | RegB)                                                         \
+  X(JGeI, RegA | RegB)                                                         \
+  X(JEqI, RegA | RegB)                                                         \
+  X(JNeI, RegA | RegB)                                                         \
+  X(JLtF, RegA | RegB)                                                         \
+  X(JGtF, RegA | RegB)                                                         \
+  X(JLeF, RegA | RegB)                                                         \
+  X(JGeF, RegA | RegB)                                                         \
+  X(JEqF, RegA | RegB)                                                         \
+  X(JNeF, RegA | RegB)                                                         \
+  X(Call, RegA | RegC)            /* A = function B, arguments from C */       \
+  X(CallNative, RegA | RegC)      /* A = native function B, arguments from C */\
+  X(Return, RegA)                 /* Return A */                               \
+  X(ReturnVoid, 0)
+
+enum class Opcode : uint8_t {
+#define OPCODE_ENUM(Name, Regs) Name,
+  BYTECODE_OPCODES(OPCODE_ENUM)
+#undef OPCODE_ENUM
+};
+
+static uint8_t getRegisterOperands(Opcode Op) {
+  static const uint8_t Operands[] = {
+#define OPCODE_OPERANDS(Name, Regs) Regs,
+      BYTECODE_OPCODES(OPCODE_OPERANDS)
+#undef OPCODE_OPERANDS
+  };
+  return Operands[unsigned(Op)];
+}
+
+/// BytecodeInstr - One bytecode instruction. Registers, functions, globals and
+/// jump targets are 16 bits, which bounds a function to 64K registers and
+/// instructions and a program to 64K functions and globals.
+struct BytecodeInstr {
+  Opcode Op;
+  uint16_t A = 0, B = 0, C = 0;
+};
+
+static constexpr unsigned MaxOperand = 0xFFFF;
+
+/// Reg - The value of a register: an int, a float or a bool (0 or 1).
+union Reg {
+  int32_t I;
+  float F;
+};
+
+/// BytecodeFunction - A function of the program, compiled if it is defined
+/// there and otherwise an extern, called natively.
+struct BytecodeFunction {
+  std::string Name;
+  MiniCType RetTy = MiniCType::Void;
+  SmallVector<MiniCType, 4> ParamTys;
+  std::vector<BytecodeInstr> Code;
+  std::vector<Reg> Constants; // Loaded into the registers after the slots
+  unsigned NumSlots = 0;
+  unsigned NumRegs = 0;
+
+  bool isDefined() const { return !Code.empty(); }
+};
+
+/// NativeFunction - An extern function, called through callNative.
+struct NativeFunction {
+  const BytecodeFunction *Decl;
+  void *Address;
+};
+
+struct BytecodeModule {
+  std::vector<BytecodeFunction> Functions;
+  std::vector<NativeFunction> Natives;
+  unsigned NumGlobals = 0;
+
+  /// lookup - The function called Name, or null.
+  const BytecodeFunction *lookup(StringRef Name) const {
+    for (const BytecodeFunction &F : Functions)
+      if (F.Name == Name)
+        return &F;
+    return nullptr;
+  }
+};
+
+// Values of native arguments and results are passed in registers, which the
+// x86-64 System V and AArch64 calling conventions fill in order, integer and
+// floating point registers separately. A call that passes six integers and
+// eight floats then serves every mix of up to that many ints, bools and
+// floats: the callee reads the registers it has parameters for.
+#if (defined(__x86_64__) && !defined(_WIN32)) || defined(__aarch64__)
+#define MCCOMP_NATIVE_BRIDGE 1
+#endif
+
+static constexpr unsigned MaxNativeIntArgs = 6;
+static constexpr unsigned MaxNativeFloatArgs = 8;
+
+template <typename RetT>
+static RetT callNativeAs(void *Address, const int64_t *I, const float *F) {
+  using NativeFn = RetT (*)(int64_t, int64_t, int64_t, int64_t, int64_t,
+                            int64_t, float, float, float, float, float, float,
+                            float, float);
+  return reinterpret_cast<NativeFn>(Address)(I[0], I[1], I[2], I[3], I[4],
+                                             I[5], F[0], F[1], F[2], F[3],
+                                             F[4], F[5], F[6], F[7]);
+}
+
+/// callNative - Call the extern F with the arguments in Args.
+static Reg callNative(const NativeFunction &F, const Reg *Args) {
+  int64_t Ints[MaxNativeIntArgs] = {};
+  float Floats[MaxNativeFloatArgs] = {};
+  unsigned NumInts = 0, NumFloats = 0;
+  for (MiniCType Ty : F.Decl->ParamTys) {
+    if (Ty == MiniCType::Float)
+      Floats[NumFloats++] = Args->F;
+    else
+      Ints[NumInts++] = Args->I;
+    ++Args;
+  }
+  Reg Result;
+  Result.I = 0;
+  switch (F.Decl->RetTy) {
+  case MiniCType::Int:
+    Result.I = callNativeAs<int>(F.Address, Ints, Floats);
+    break;
+  case MiniCType::Float:
+    Result.F = callNativeAs<float>(F.Address, Ints, Floats);
+    break;
+  case MiniCType::Bool:
+    Result.I = callNativeAs<bool>(F.Address, Ints, Floats);
+    break;
+  default:
+    callNativeAs<void>(F.Address, Ints, Floats);
+    break;
+  }
+  return Result;
+}
+
+/// BytecodeCompiler - Compiles a typed, folded AST to a BytecodeModule, one
+/// function at a time, as the nodes' compile() methods direct.
+///
+/// Constants and temporaries are numbered provisionally while a function is
+/// compiled, constants down from MaxOperand and temporaries up from the
+/// slots, and renumbered once the function is done and the number of
+/// constants is known.
+class BytecodeCompiler {
+  enum : unsigned { NoIndex = ~0u };
+
+  BytecodeModule &M;
+  const StringInterner &Symbols;
+  std::vector<unsigned> FunctionIndices; // Indexed by symbol id
+  std::vector<unsigned> GlobalIndices;   // Indexed by symbol id
+  unsigned CurFunction = 0; // Index of the function being compiled
+  DenseMap<uint64_t, unsigned> ConstantRegs; // By type and bits
+  unsigned NextTemp = 0;
+  unsigned MaxTemp = 0;
+  bool TooLarge = false;
+
+public:
+  BytecodeCompiler(BytecodeModule &M, const StringInterner &Symbols)
+      : M(M), Symbols(Symbols), FunctionIndices(Symbols.size(), NoIndex),
+        GlobalIndices(Symbols.size(), NoIndex) {}
+
+  /// getFunction - The index of the function Symbol, which returns RetTy
+  /// and takes ParamTys. Functions are numbered as they are first seen, by a
+  /// call or a definition.
+  unsigned getFunction(unsigned Symbol, MiniCType RetTy,
+                       ArrayRef<MiniCType> ParamTys) {
+    unsigned &Index = FunctionIndices[Symbol];
+    if (Index == NoIndex) {
+      Index = M.Functions.size();
+      M.Functions.emplace_back();
+      BytecodeFunction &F = M.Functions.back();
+      F.Name = Symbols.getName(Symbol).str();
+      F.RetTy = RetTy;
+      F.ParamTys.assign(ParamTys.begin(), ParamTys.end());
+    }
+    return Index;
+  }
 
-  if(!f->empty()){
-    std::string stringy = "Function '" + function->getName() +"' cannot be redefined";
-    return (Function*)LogErrorV(stringy.c_str());
+  unsigned getGlobal(unsigned Symbol) {
+    unsigned &Index = GlobalIndices[Symbol];
+    if (Index == NoIndex)
+      Index = M.NumGlobals++;
+    return Index;
   }
 
-  BasicBlock *basicblock = BasicBlock::Create(TheContext, "block", f);
-  Builder.SetInsertPoint(basicblock);
+  void beginFunction(unsigned Symbol, MiniCType RetTy,
+                     ArrayRef<MiniCType> ParamTys, unsigned NumSlots) {
+    CurFunction = getFunction(Symbol, RetTy, ParamTys);
+    getCurFunction().NumSlots = NumSlots;
+    ConstantRegs.clear();
+    NextTemp = MaxTemp = NumSlots;
+  }
 
+  void endFunction();
 
-  NamedValues.clear();
-  for (auto &argument : f->args()){
-    IRBuilder<> Tmp(&f->getEntryBlock(), f->getEntryBlock().begin());
-    AllocaInst *Alloca = Tmp.CreateAlloca(argument.getType(), 0, argument.getName());
-    Builder.CreateStore(&argument, Alloca);
-    std::string s = std::string(argument.getName());
-    NamedValues[s] = Alloca;
+  /// getCurFunction - The function being compiled. Calls add functions, so
+  /// this is only good until the next getFunction().
+  BytecodeFunction &getCurFunction() { return M.Functions[CurFunction]; }
+
+  /// getConstant - A register holding V throughout the function.
+  unsigned getConstant(const ConstantValue &V) {
+    Reg Value;
+    uint32_t Bits;
+    if (V.Ty == MiniCType::Float) {
+      Value.F = V.Float;
+      Bits = FloatToBits(V.Float);
+    } else {
+      Value.I = V.Ty == MiniCType::Bool ? V.Bool : V.Int;
+      Bits = Value.I;
+    }
+    uint64_t Key = uint64_t(V.Ty) << 32 | Bits;
+    std::vector<Reg> &Constants = getCurFunction().Constants;
+    auto Inserted = ConstantRegs.try_emplace(Key, Constants.size());
+    if (Inserted.second)
+      Constants.push_back(Value);
+    return MaxOperand - Inserted.first->second;
   }
-  
-  Value *returner  = funcBody->codegen();
-  Builder.CreateRet(returner);
 
-  verifyFunction(*f);
+  unsigned allocTemp() {
+    MaxTemp = std::max(MaxTemp, NextTemp + 1);
+    return NextTemp++;
+  }
 
-  return f;
-}
+  /// getTempMark / releaseTemps - Free the temporaries allocated since the
+  /// mark was taken.
+  unsigned getTempMark() const { return NextTemp; }
+  void releaseTemps(unsigned Mark) { NextTemp = Mark; }
 
-Value *assignmentASTnode::codegen(){
-  Value *value = expr->codegen();
-  if(value){
-    Value *variableName = NamedValues[ident->to_string()];
-    if(!variableName){
-      variableName = TheModule->getNamedValue(ident->to_string());
-      if(!variableName){
-      std::string error = "Cannot assign variable '" + ident->to_string() + "' since it does not exist in the current scope";
-      return LogErrorV(error.c_str());
-      }
-    }
-    auto expressionType = value->getType();
-    auto variableType = Builder.CreateLoad(variableName, ident->to_string())->getType();
+  /// getDest - The register to compute an expression bound for Dst into.
+  unsigned getDest(unsigned Dst) { return Dst == AnyReg ? allocTemp() : Dst; }
 
-    Builder.CreateStore(value, variableName);
-    return value;
+  /// emitMove - Put the value in Src where an expression bound for Dst
+  /// leaves its value, and return that register.
+  unsigned emitMove(unsigned Dst, unsigned Src) {
+    if (Dst == AnyReg || Dst == Src)
+      return Src;
+    emit(Opcode::Mov, Dst, Src);
+    return Dst;
   }
-  else{
-    return nullptr;
+
+  /// emit - Append an instruction to the function and return its index.
+  unsigned emit(Opcode Op, unsigned A = 0, unsigned B = 0, unsigned C = 0) {
+    BytecodeInstr I;
+    I.Op = Op;
+    I.A = A;
+    I.B = B;
+    I.C = C;
+    std::vector<BytecodeInstr> &Code = getCurFunction().Code;
+    Code.push_back(I);
+    return Code.size() - 1;
   }
-}
 
-Value *globalASTnode::codegen(){
-  if(type->getType() == INT_TOK){
-    return new GlobalVariable(*TheModule, Type::getInt32Ty(TheContext), false, GlobalValue::CommonLinkage, ConstantInt::get(TheContext, APInt(32,0)), ident->to_string());
+  unsigned getPC() { return getCurFunction().Code.size(); }
+
+  void setJumpTarget(unsigned Jump, unsigned Target) {
+    getCurFunction().Code[Jump].C = Target;
   }
-  else if (type->getType() == BOOL_TOK){
-    return new GlobalVariable(*TheModule, Type::getInt1Ty(TheContext), false, GlobalValue::CommonLinkage, ConstantInt::get(TheContext, APInt(1,0)), ident->to_string());
-  }  
-  else if (type->getType() == FLOAT_TOK){
-    return new GlobalVariable(*TheModule, Type::getFloatTy(TheContext), false, GlobalValue::CommonLinkage, ConstantFP::get(TheContext, APFloat((float)0)), ident->to_string());
+
+  unsigned emitValue(ASTnode *E, unsigned Dst);
+  void emitOperands(ASTnode *LHS, ASTnode *RHS, unsigned &L, unsigned &R);
+  unsigned emitShortCircuit(ASTnode *LHS, ASTnode *RHS, bool IsAnd,
+                            unsigned Dst);
+
+  /// finish - Resolve the externs the program calls and finish the module.
+  /// Returns false after reporting an error.
+  bool finish();
+};
+
+void BytecodeCompiler::endFunction() {
+  // Falling off the end of the body returns nothing, or zero from a function
+  // with a result.
+  BytecodeFunction &Fn = getCurFunction();
+  if (Fn.RetTy == MiniCType::Void)
+    emit(Opcode::ReturnVoid);
+  else
+    emit(Opcode::Return, getConstant(ConstantValue{Fn.RetTy}));
+
+  unsigned NumSlots = Fn.NumSlots;
+  unsigned NumConstants = Fn.Constants.size();
+  unsigned FirstConstant = MaxOperand + 1 - NumConstants;
+  Fn.NumRegs = MaxTemp + NumConstants;
+  if (MaxTemp > FirstConstant || Fn.Code.size() > MaxOperand + 1) {
+    errs() << "Function '" << Fn.Name << "' is too large to interpret\n";
+    TooLarge = true;
+    return;
+  }
+  auto Renumber = [&](uint16_t &Operand) {
+    if (Operand >= FirstConstant)
+      Operand = NumSlots + (MaxOperand - Operand);
+    else if (Operand >= NumSlots)
+      Operand += NumConstants;
+  };
+  for (BytecodeInstr &I : Fn.Code) {
+    uint8_t Regs = getRegisterOperands(I.Op);
+    if (Regs & RegA)
+      Renumber(I.A);
+    if (Regs & RegB)
+      Renumber(I.B);
+    if (Regs & RegC)
+      Renumber(I.C);
   }
-  return nullptr;
 }
 
-Value *returnASTnode::codegen() {
-  if(expression){
-    return expression->codegen();
-  }
-  return nullptr;
+/// emitValue - Compile the expression E into Dst, applying the implicit
+/// conversion Sema attached to it, and return the register holding it.
+unsigned BytecodeCompiler::emitValue(ASTnode *E, unsigned Dst) {
+  Conversion C = E->getConversion();
+  if (C == Conversion::None)
+    return E->compile(*this, Dst);
+  if (Optional<ConstantValue> V = E->getConstant())
+    return emitMove(Dst, getConstant(convertConstant(*V, C)));
+  unsigned Mark = getTempMark();
+  unsigned Src = E->compile(*this, AnyReg);
+  releaseTemps(Mark);
+  unsigned D = getDest(Dst);
+  emit(Opcode::IntToFloat, D, Src);
+  return D;
 }
 
-Value *ifASTnode::codegen(){
-  Value *condition = expr->codegen();
+/// emitOperands - Compile the operands of a binary operator into registers
+/// L and R, in order.
+void BytecodeCompiler::emitOperands(ASTnode *LHS, ASTnode *RHS, unsigned &L,
+                                    unsigned &R) {
+  // LHS may be left in the local it reads, unless RHS could assign that.
+  L = emitValue(LHS, RHS->getSpeculationCost() == NotSpeculatable
+                         ? allocTemp()
+                         : AnyReg);
+  R = emitValue(RHS, AnyReg);
+}
+
+/// emitShortCircuit - Compile LHS && RHS or LHS || RHS, evaluating RHS only
+/// if LHS does not decide the result.
+unsigned BytecodeCompiler::emitShortCircuit(ASTnode *LHS, ASTnode *RHS,
+                                            bool IsAnd, unsigned Dst) {
+  // Dst may be a local that RHS reads, so it is assigned only at the end.
+  unsigned Result = allocTemp();
+  emitValue(LHS, Result);
+  unsigned Skip = emit(IsAnd ? Opcode::JumpIfNot : Opcode::JumpIf, Result);
+  emitValue(RHS, Result);
+  setJumpTarget(Skip, getPC());
+  releaseTemps(Result + 1);
+  return emitMove(Dst, Result);
+}
 
-  if(condition){
-    if(condition->getType() == Type::getInt1Ty(TheContext)){
-      condition= Builder.CreateICmpNE(condition, ConstantInt::get(TheContext, APInt(1, 0, false)), "ifconditionS");
+bool BytecodeCompiler::finish() {
+  if (TooLarge)
+    return false;
+  if (M.Functions.size() > MaxOperand + 1 || M.NumGlobals > MaxOperand + 1) {
+    errs() << "Program is too large to interpret\n";
+    return false;
+  }
+
+  // Functions called but not defined are externs, looked up like the JIT
+  // looks them up and called natively.
+  std::vector<unsigned> NativeIndices(M.Functions.size(), NoIndex);
+  sys::DynamicLibrary::LoadLibraryPermanently(nullptr);
+  for (unsigned i = 0; i != M.Functions.size(); ++i) {
+    const BytecodeFunction &F = M.Functions[i];
+    if (F.isDefined())
+      continue;
+    void *Address;
+    if (F.Name == "print_int")
+      Address = reinterpret_cast<void *>(&runtimePrintInt);
+    else if (F.Name == "print_float")
+      Address = reinterpret_cast<void *>(&runtimePrintFloat);
+    else
+      Address = sys::DynamicLibrary::SearchForAddressOfSymbol(F.Name);
+    if (!Address) {
+      errs() << "Could not find extern function '" << F.Name << "'\n";
+      return false;
     }
-    else{
-      condition = Builder.CreateFCmpONE(condition, ConstantFP::get(TheContext, APFloat(0.0)), "ifcondition");
+#ifdef MCCOMP_NATIVE_BRIDGE
+    unsigned NumFloats = count(F.ParamTys, MiniCType::Float);
+    if (F.ParamTys.size() - NumFloats > MaxNativeIntArgs ||
+        NumFloats > MaxNativeFloatArgs) {
+      errs() << "Extern function '" << F.Name
+             << "' has too many parameters to call from the interpreter\n";
+      return false;
     }
+#else
+    errs() << "Extern function '" << F.Name
+           << "' cannot be called from the interpreter on this host\n";
+    return false;
+#endif
+    NativeIndices[i] = M.Natives.size();
+    M.Natives.push_back({&F, Address});
+  }
+
+  for (BytecodeFunction &F : M.Functions)
+    for (BytecodeInstr &I : F.Code)
+      if (I.Op == Opcode::Call && NativeIndices[I.B] != NoIndex) {
+        I.Op = Opcode::CallNative;
+        I.B = NativeIndices[I.B];
+      }
+  return true;
+}
 
-    Function *function = Builder.GetInsertBlock()->getParent();
+unsigned ASTnode::compileBranch(BytecodeCompiler &C, bool WhenTrue) {
+  unsigned Mark = C.getTempMark();
+  unsigned Cond = C.emitValue(this, AnyReg);
+  C.releaseTemps(Mark);
+  return C.emit(WhenTrue ? Opcode::JumpIf : Opcode::JumpIfNot, Cond);
+}
 
-    BasicBlock *then = BasicBlock::Create(TheContext, "then", function);
-    BasicBlock *elseBB = BasicBlock::Create(TheContext, "else bock");
-    BasicBlock *mergeBB = BasicBlock::Create(TheContext, "after if block");
-    if(!elseBlock){
-      Builder.CreateCondBr(condition, then, mergeBB);
-      Builder.SetInsertPoint(then);
-      Value *thenVal = block->codegen();
-      if(thenVal){
-        Builder.CreateBr(mergeBB);
-        then = Builder.GetInsertBlock();
-        function->getBasicBlockList().push_back(mergeBB);
-        Builder.SetInsertPoint(mergeBB);
-        return condition;
-      }
-      else{
-        return nullptr;
-      }
-    }
-    else{
-      Builder.CreateCondBr(condition, then, elseBB);
-      Builder.SetInsertPoint(then);
+unsigned IntASTnode::compile(BytecodeCompiler &C, unsigned Dst) {
+  return C.emitMove(Dst, C.getConstant(ConstantValue::getInt(Val)));
+}
 
-      Value *thenValue = block->codegen();
-      if(!thenValue){
-        return nullptr;
-      }
+unsigned floatASTnode::compile(BytecodeCompiler &C, unsigned Dst) {
+  return C.emitMove(Dst, C.getConstant(ConstantValue::getFloat(Val)));
+}
 
+unsigned boolASTnode::compile(BytecodeCompiler &C, unsigned Dst) {
+  return C.emitMove(Dst, C.getConstant(ConstantValue::getBool(Val)));
+}
 
-      Builder.CreateBr(mergeBB);
-      then = Builder.GetInsertBlock();
+unsigned identASTnode::compile(BytecodeCompiler &C, unsigned Dst) {
+  if (Slot != NoSlot)
+    return C.emitMove(Dst, Slot);
+  unsigned D = C.getDest(Dst);
+  C.emit(Opcode::GetGlobal, D, C.getGlobal(getSymbol()));
+  return D;
+}
 
-      function->getBasicBlockList().push_back(elseBB);
-      Builder.SetInsertPoint(elseBB);
+unsigned notAndNegativeASTnode::compile(BytecodeCompiler &C, unsigned Dst) {
+  unsigned Mark = C.getTempMark();
+  unsigned Operand = C.emitValue(expression, AnyReg);
+  C.releaseTemps(Mark);
+  unsigned D = C.getDest(Dst);
+  if (prefix == '!')
+    C.emit(Opcode::Not, D, Operand);
+  else
+    C.emit(Ty == MiniCType::Int ? Opcode::NegI : Opcode::NegF, D, Operand);
+  return D;
+}
 
-      Value *elseValue = elseBlock->codegen();
+/// getBinaryOpcode - The instruction for Op on two operands of type Ty.
+static Opcode getBinaryOpcode(MiniCType Ty, BinOp Op) {
+  bool IsFloat = Ty == MiniCType::Float;
+  switch (Op) {
+  case BinOp::Or:
+    return Opcode::Or;
+  case BinOp::And:
+    return Opcode::And;
+  case BinOp::EQ:
+    return IsFloat ? Opcode::EqF : Opcode::EqI;
+  case BinOp::NE:
+    return IsFloat ? Opcode::NeF : Opcode::NeI;
+  case BinOp::LE:
+    return IsFloat ? Opcode::LeF : Opcode::LeI;
+  case BinOp::LT:
+    return IsFloat ? Opcode::LtF : Opcode::LtI;
+  case BinOp::GE:
+    return IsFloat ? Opcode::GeF : Opcode::GeI;
+  case BinOp::GT:
+    return IsFloat ? Opcode::GtF : Opcode::GtI;
+  case BinOp::Add:
+    return IsFloat ? Opcode::AddF : Opcode::AddI;
+  case BinOp::Sub:
+    return IsFloat ? Opcode::SubF : Opcode::SubI;
+  case BinOp::Mul:
+    return IsFloat ? Opcode::MulF : Opcode::MulI;
+  case BinOp::Div:
+    return IsFloat ? Opcode::DivF : Opcode::DivI;
+  case BinOp::Rem:
+    return IsFloat ? Opcode::RemF : Opcode::RemI;
+  }
+  llvm_unreachable("unknown binary operator");
+}
 
-      if(!elseValue){
-        return nullptr;
-      }
+/// getBranchOpcode - The jump taken when the comparison Op of two operands
+/// of type Ty is WhenTrue, if there is one.
+static Optional<Opcode> getBranchOpcode(MiniCType Ty, BinOp Op,
+                                        bool WhenTrue) {
+  // An int comparison is false when the inverse one is true; a float one is
+  // not, if the operands are unordered.
+  if (Ty == MiniCType::Float && !WhenTrue)
+    return None;
+  bool IsFloat = Ty == MiniCType::Float;
+  switch (Op) {
+  case BinOp::EQ:
+    return WhenTrue ? (IsFloat ? Opcode::JEqF : Opcode::JEqI) : Opcode::JNeI;
+  case BinOp::NE:
+    return WhenTrue ? (IsFloat ? Opcode::JNeF : Opcode::JNeI) : Opcode::JEqI;
+  case BinOp::LE:
+    return WhenTrue ? (IsFloat ? Opcode::JLeF : Opcode::JLeI) : Opcode::JGtI;
+  case BinOp::LT:
+    return WhenTrue ? (IsFloat ? Opcode::JLtF : Opcode::JLtI) : Opcode::JGeI;
+  case BinOp::GE:
+    return WhenTrue ? (IsFloat ? Opcode::JGeF : Opcode::JGeI) : Opcode::JLtI;
+  case BinOp::GT:
+    return WhenTrue ? (IsFloat ? Opcode::JGtF : Opcode::JGtI) : Opcode::JLeI;
+  default:
+    return None;
+  }
+}
 
-      Builder.CreateBr(mergeBB);
+unsigned expressionASTnode::compile(BytecodeCompiler &C, unsigned Dst) {
+  if (Op == BinOp::And || Op == BinOp::Or)
+    return C.emitShortCircuit(left, right, Op == BinOp::And, Dst);
+  unsigned Mark = C.getTempMark();
+  unsigned L, R;
+  C.emitOperands(left, right, L, R);
+  C.releaseTemps(Mark);
+  unsigned D = C.getDest(Dst);
+  C.emit(getBinaryOpcode(OperandTy, Op), D, L, R);
+  return D;
+}
 
-      elseBB = Builder.GetInsertBlock();
+unsigned expressionASTnode::compileBranch(BytecodeCompiler &C,
+                                          bool WhenTrue) {
+  Optional<Opcode> Jump = getBranchOpcode(OperandTy, Op, WhenTrue);
+  if (!Jump)
+    return ASTnode::compileBranch(C, WhenTrue);
+  unsigned Mark = C.getTempMark();
+  unsigned L, R;
+  C.emitOperands(left, right, L, R);
+  C.releaseTemps(Mark);
+  return C.emit(*Jump, L, R);
+}
 
-      function->getBasicBlockList().push_back(mergeBB);
-      Builder.SetInsertPoint(mergeBB);
+/// getConvertedType - The type of E's value once converted for its user.
+static MiniCType getConvertedType(const ASTnode *E) {
+  return E->getConversion() == Conversion::IntToFloat ? MiniCType::Float
+                                                      : E->getExprType();
+}
 
-      PHINode *pnode;
-      if(thenValue->getType() == Type::getInt32Ty(TheContext)){
-        pnode = Builder.CreatePHI(Type::getInt32Ty(TheContext), 2, "then tmp");
-      }
-      else if(thenValue->getType() == Type::getInt1Ty(TheContext)){
-        pnode = Builder.CreatePHI(Type::getInt1Ty(TheContext), 2, "then tmp");
-      }
-      else if(thenValue->getType() == Type::getFloatTy(TheContext)){
-        pnode = Builder.CreatePHI(Type::getFloatTy(TheContext), 2, "then tmp");
-      }
-      else{
-        std::string stringy = "Unable to create PHINode for if statement '" +expr->to_string() + "'"; 
-        return LogErrorV(stringy.c_str());
-      }
+unsigned functionCall::compile(BytecodeCompiler &C, unsigned Dst) {
+  // The arguments go in the topmost registers, where the callee's frame
+  // begins.
+  unsigned Args = C.getTempMark();
+  SmallVector<MiniCType, 8> ArgTys;
+  for (ASTnode *Arg : arguments) {
+    C.allocTemp();
+    ArgTys.push_back(getConvertedType(Arg));
+  }
+  for (unsigned i = 0; i != arguments.size(); ++i) {
+    C.emitValue(arguments[i], Args + i);
+    C.releaseTemps(Args + arguments.size());
+  }
+  C.releaseTemps(Args);
+  unsigned D = C.getDest(Dst);
+  C.emit(Opcode::Call, D, C.getFunction(caller.symbol, Ty, ArgTys), Args);
+  return D;
+}
 
-      pnode->addIncoming(thenValue, then);
-      pnode->addIncoming(elseValue, elseBB);
-      return pnode;
-    }
-    
+unsigned assignmentASTnode::compile(BytecodeCompiler &C, unsigned Dst) {
+  unsigned Slot = ident->getSlot();
+  if (Slot != NoSlot)
+    return C.emitMove(Dst, C.emitValue(expr, Slot));
+  unsigned Value = C.emitValue(expr, Dst);
+  C.emit(Opcode::SetGlobal, C.getGlobal(ident->getSymbol()), Value);
+  return Value;
+}
+
+unsigned returnASTnode::compile(BytecodeCompiler &C, unsigned Dst) {
+  if (expression)
+    C.emit(Opcode::Return, C.emitValue(expression, AnyReg));
+  else
+    C.emit(Opcode::ReturnVoid);
+  return AnyReg;
+}
+
+unsigned ifASTnode::compile(BytecodeCompiler &C, unsigned Dst) {
+  unsigned ToElse = expr->compileBranch(C, false);
+  block->compile(C, AnyReg);
+  if (elseBlock) {
+    unsigned ToEnd = C.emit(Opcode::Jump);
+    C.setJumpTarget(ToElse, C.getPC());
+    elseBlock->compile(C, AnyReg);
+    C.setJumpTarget(ToEnd, C.getPC());
+  } else {
+    C.setJumpTarget(ToElse, C.getPC());
   }
-  else{
-    return nullptr;
+  return AnyReg;
+}
+
+unsigned whileASTnode::compile(BytecodeCompiler &C, unsigned Dst) {
+  // The condition is tested at the bottom, so each iteration takes one jump.
+  unsigned ToCond = C.emit(Opcode::Jump);
+  unsigned Body = C.getPC();
+  unsigned Mark = C.getTempMark();
+  stmt->compile(C, AnyReg);
+  C.releaseTemps(Mark);
+  C.setJumpTarget(ToCond, C.getPC());
+  C.setJumpTarget(expr->compileBranch(C, true), Body);
+  return AnyReg;
+}
+
+unsigned BlockASTnode::compile(BytecodeCompiler &C, unsigned Dst) {
+  // Locals already have their slots.
+  for (ASTnode *Statement : statements) {
+    unsigned Mark = C.getTempMark();
+    Statement->compile(C, AnyReg);
+    C.releaseTemps(Mark);
   }
+  return AnyReg;
 }
 
-Value *whileASTnode::codegen(){
-  Function *func = Builder.GetInsertBlock()->getParent();
-  BasicBlock *condition = BasicBlock::Create(TheContext, "condition", func);
-  BasicBlock *loop = BasicBlock::Create(TheContext, "while loop", func);
-  BasicBlock *afterLoop = BasicBlock::Create(TheContext, "after loop", func);
+unsigned globalASTnode::compile(BytecodeCompiler &C, unsigned Dst) {
+  return AnyReg;
+}
 
-  Builder.CreateBr(condition);
-  Builder.SetInsertPoint(condition);
+// Globals are numbered as they are first used.
+unsigned parameterASTnode::compile(BytecodeCompiler &C, unsigned Dst) {
+  return AnyReg;
+}
+
+// Externs are numbered as they are first called.
+unsigned externASTnode::compile(BytecodeCompiler &C, unsigned Dst) {
+  return AnyReg;
+}
 
-  Value *endCond = expr->codegen();
-  if(!endCond) return nullptr;
+unsigned functionASTnode::compile(BytecodeCompiler &C, unsigned Dst) {
+  C.beginFunction(function->getSymbol(), getMiniCType(function->getType()),
+                  getParamTypes(function->getParameters()), NumSlots);
+  funcBody->compile(C, AnyReg);
+  C.endFunction();
+  return AnyReg;
+}
 
-  endCond = Builder.CreateFCmpONE(endCond, ConstantFP::get(TheContext, APFloat(0.0)), "loop cond");
+unsigned programASTnode::compile(BytecodeCompiler &C, unsigned Dst) {
+  for (ASTnode *Decl : declList)
+    Decl->compile(C, AnyReg);
+  return AnyReg;
+}
 
-  Builder.CreateCondBr(endCond, loop, afterLoop);
-  Builder.SetInsertPoint(loop);
+/// Interpreter - Runs the functions of a BytecodeModule. The registers of
+/// every active call live on one stack.
+class Interpreter {
+  struct Frame {
+    const BytecodeFunction *Fn;
+    const BytecodeInstr *ReturnPC;
+    size_t Base;
+    unsigned Result; // The caller's register for the return value
+  };
 
-  if(stmt->codegen()){
-    Builder.CreateBr(condition);
-    Builder.SetInsertPoint(afterLoop);
-    return Constant::getNullValue(Type::getFloatTy(TheContext));
+  // Calls deeper than this many registers in all overflow the stack.
+  static constexpr size_t MaxStackRegs = size_t(1) << 24;
+
+  const BytecodeModule &M;
+  std::vector<Reg> Globals;
+  std::vector<Reg> Stack;
+  std::vector<Frame> Frames;
+
+  /// enterFrame - Set up the registers R of a call to F, whose arguments are
+  /// already in place: load the constants and zero the locals.
+  static void enterFrame(const BytecodeFunction &F, Reg *R) {
+    Reg Zero;
+    Zero.I = 0;
+    std::fill(R + F.ParamTys.size(), R + F.NumSlots, Zero);
+    std::copy(F.Constants.begin(), F.Constants.end(), R + F.NumSlots);
+  }
+
+  /// reserve - Make room on the stack for Size registers. Returns false if
+  /// they would overflow it.
+  bool reserve(size_t Size) {
+    if (Size <= Stack.size())
+      return true;
+    if (Size > MaxStackRegs)
+      return false;
+    Stack.resize(std::max(Size, 2 * Stack.size()));
+    return true;
   }
 
-  return nullptr;
-}
+public:
+  explicit Interpreter(const BytecodeModule &M)
+      : M(M), Globals(M.NumGlobals) {}
 
-Value *notAndNegativeASTnode::codegen(){
-  Value *value = expression->codegen();
+  /// run - Call the defined function F with Args and store what it returns in
+  /// Result. Returns false after reporting a runtime error.
+  bool run(const BytecodeFunction &F, ArrayRef<Reg> Args, Reg &Result);
+};
 
-  if(value){
-    if(prefix == '!'){
-      if(value->getType() == Type::getInt32Ty(TheContext)){
-        return LogErrorV("'!' operation cannot be applied to type 'int'");
-      }
-      else if(value->getType() == Type::getInt1Ty(TheContext)){
-        return Builder.CreateNot(value, "not temp");
-      }
-      else if(value->getType() == Type::getFloatTy(TheContext)){
-        return LogErrorV("'!' operation cannot be applied to type 'float'");
-      }
-    }
-    else if(prefix == '-'){
-      if(value->getType() == Type::getInt32Ty(TheContext)){
-        return Builder.CreateFPToSI(Builder.CreateFNeg(Builder.CreateSIToFP(value, Type::getFloatTy(TheContext), "int->float"), "neg temp"), Type::getInt32Ty(TheContext), "int->float");
-      }
-      else if(value->getType() == Type::getInt1Ty(TheContext)){
-        return LogErrorV("'-' operation cannot be applied to type 'bool'");
-      }
-      else if(value->getType() == Type::getFloatTy(TheContext)){
-        return Builder.CreateFNeg(value, "neg temp");
-      }
+// Dispatch jumps straight from one instruction's code to the next one's
+// through a table of label addresses where the compiler supports that, and
+// otherwise goes through a switch.
+#if defined(__GNUC__)
+#define MCCOMP_COMPUTED_GOTO 1
+#endif
+
+bool Interpreter::run(const BytecodeFunction &F, ArrayRef<Reg> Args,
+                      Reg &Result) {
+  const BytecodeFunction *Fn = &F;
+  size_t Base = 0;
+  Frames.clear();
+  reserve(std::max<size_t>(Fn->NumRegs, 4096));
+  std::copy(Args.begin(), Args.end(), Stack.begin());
+  enterFrame(*Fn, Stack.data());
+
+  const BytecodeInstr *Code = Fn->Code.data();
+  const BytecodeInstr *PC = Code;
+  Reg *R = Stack.data();
+  Reg *G = Globals.data();
+  const char *Message;
+
+#ifdef MCCOMP_COMPUTED_GOTO
+  static const void *const Labels[] = {
+#define OPCODE_LABEL(Name, Regs) &&Op##Name,
+      BYTECODE_OPCODES(OPCODE_LABEL)
+#undef OPCODE_LABEL
+  };
+#define DISPATCH() goto *Labels[unsigned(PC->Op)]
+#define OP(Name) Op##Name:
+  DISPATCH();
+#else
+#define DISPATCH() goto Dispatch
+#define OP(Name) case Opcode::Name:
+Dispatch:
+  switch (PC->Op) {
+#endif
+#define NEXT()                                                                 \
+  do {                                                                         \
+    ++PC;                                                                      \
+    DISPATCH();                                                                \
+  } while (0)
+#define JUMP_IF(Cond)                                                          \
+  do {                                                                         \
+    PC = (Cond) ? Code + PC->C : PC + 1;                                       \
+    DISPATCH();                                                                \
+  } while (0)
+// Int arithmetic is done unsigned, where it wraps.
+#define INT_ARITH(Name, Operator)                                              \
+  OP(Name)                                                                     \
+  R[PC->A].I = int32_t(uint32_t(R[PC->B].I) Operator uint32_t(R[PC->C].I));    \
+  NEXT();
+#define FLOAT_ARITH(Name, Operator)                                            \
+  OP(Name) R[PC->A].F = R[PC->B].F Operator R[PC->C].F;                        \
+  NEXT();
+#define COMPARE(Name, Field, Expr)                                             \
+  OP(Name) {                                                                   \
+    auto X = R[PC->B].Field, Y = R[PC->C].Field;                               \
+    R[PC->A].I = (Expr);                                                       \
+    NEXT();                                                                    \
+  }
+#define BRANCH(Name, Field, Expr)                                              \
+  OP(Name) {                                                                   \
+    auto X = R[PC->A].Field, Y = R[PC->B].Field;                               \
+    JUMP_IF(Expr);                                                             \
+  }
+
+  OP(Mov) R[PC->A] = R[PC->B];
+  NEXT();
+  OP(IntToFloat) R[PC->A].F = float(R[PC->B].I);
+  NEXT();
+  INT_ARITH(AddI, +)
+  INT_ARITH(SubI, -)
+  INT_ARITH(MulI, *)
+  OP(DivI) {
+    int32_t X = R[PC->B].I, Y = R[PC->C].I;
+    if (Y == 0 || (Y == -1 && X == std::numeric_limits<int32_t>::min()))
+      goto DivisionError;
+    R[PC->A].I = X / Y;
+    NEXT();
+  }
+  OP(RemI) {
+    int32_t X = R[PC->B].I, Y = R[PC->C].I;
+    if (Y == 0 || (Y == -1 && X == std::numeric_limits<int32_t>::min()))
+      goto DivisionError;
+    R[PC->A].I = X % Y;
+    NEXT();
+  }
+  FLOAT_ARITH(AddF, +)
+  FLOAT_ARITH(SubF, -)
+  FLOAT_ARITH(MulF, *)
+  FLOAT_ARITH(DivF, /)
+  OP(RemF) R[PC->A].F = std::fmod(R[PC->B].F, R[PC->C].F);
+  NEXT();
+  OP(NegI) R[PC->A].I = int32_t(0u - uint32_t(R[PC->B].I));
+  NEXT();
+  OP(NegF) R[PC->A].F = -R[PC->B].F;
+  NEXT();
+  OP(Not) R[PC->A].I = R[PC->B].I ^ 1;
+  NEXT();
+  OP(And) R[PC->A].I = R[PC->B].I & R[PC->C].I;
+  NEXT();
+  OP(Or) R[PC->A].I = R[PC->B].I | R[PC->C].I;
+  NEXT();
+  COMPARE(LtI, I, X < Y)
+  COMPARE(GtI, I, X > Y)
+  COMPARE(LeI, I, X <= Y)
+  COMPARE(GeI, I, X >= Y)
+  COMPARE(EqI, I, X == Y)
+  COMPARE(NeI, I, X != Y)
+  COMPARE(LtF, F, !(X >= Y))
+  COMPARE(GtF, F, !(X <= Y))
+  COMPARE(LeF, F, !(X > Y))
+  COMPARE(GeF, F, !(X < Y))
+  COMPARE(EqF, F, !(X < Y || X > Y))
+  COMPARE(NeF, F, X != Y)
+  OP(GetGlobal) R[PC->A] = G[PC->B];
+  NEXT();
+  OP(SetGlobal) G[PC->A] = R[PC->B];
+  NEXT();
+  OP(Jump) PC = Code + PC->C;
+  DISPATCH();
+  OP(JumpIf) JUMP_IF(R[PC->A].I);
+  OP(JumpIfNot) JUMP_IF(!R[PC->A].I);
+  BRANCH(JLtI, I, X < Y)
+  BRANCH(JGtI, I, X > Y)
+  BRANCH(JLeI, I, X <= Y)
+  BRANCH(JGeI, I, X >= Y)
+  BRANCH(JEqI, I, X == Y)
+  BRANCH(JNeI, I, X != Y)
+  BRANCH(JLtF, F, !(X >= Y))
+  BRANCH(JGtF, F, !(X <= Y))
+  BRANCH(JLeF, F, !(X > Y))
+  BRANCH(JGeF, F, !(X < Y))
+  BRANCH(JEqF, F, !(X < Y || X > Y))
+  BRANCH(JNeF, F, X != Y)
+  OP(Call) {
+    const BytecodeFunction &Callee = M.Functions[PC->B];
+    size_t CalleeBase = Base + PC->C;
+    if (!reserve(CalleeBase + Callee.NumRegs))
+      goto StackOverflow;
+    Frames.push_back({Fn, PC + 1, Base, PC->A});
+    Fn = &Callee;
+    Base = CalleeBase;
+    R = Stack.data() + Base;
+    enterFrame(Callee, R);
+    Code = PC = Callee.Code.data();
+    DISPATCH();
+  }
+  OP(CallNative) R[PC->A] = callNative(M.Natives[PC->B], R + PC->C);
+  NEXT();
+  OP(Return) {
+    Reg Value = R[PC->A];
+    if (Frames.empty()) {
+      Result = Value;
+      return true;
     }
-    else{
-      return LogErrorV("Expected either '-' or '!' all other unary operators are invalid");
+    const Frame &Caller = Frames.back();
+    Fn = Caller.Fn;
+    Base = Caller.Base;
+    R = Stack.data() + Base;
+    R[Caller.Result] = Value;
+    PC = Caller.ReturnPC;
+    Code = Fn->Code.data();
+    Frames.pop_back();
+    DISPATCH();
+  }
+  OP(ReturnVoid) {
+    if (Frames.empty()) {
+      Result.I = 0;
+      return true;
     }
-  }
-  else{
-    return nullptr;
-  }
+    const Frame &Caller = Frames.back();
+    Fn = Caller.Fn;
+    Base = Caller.Base;
+    R = Stack.data() + Base;
+    PC = Caller.ReturnPC;
+    Code = Fn->Code.data();
+    Frames.pop_back();
+    DISPATCH();
+  }
+#ifndef MCCOMP_COMPUTED_GOTO
+  }
+  llvm_unreachable("unknown opcode");
+#endif
+#undef BRANCH
+#undef COMPARE
+#undef FLOAT_ARITH
+#undef INT_ARITH
+#undef JUMP_IF
+#undef NEXT
+#undef OP
+#undef DISPATCH
+
+DivisionError:
+  Message = "integer division by zero or overflow";
+  goto Trap;
+StackOverflow:
+  Message = "stack overflow";
+Trap:
+  errs() << "Runtime error in function '" << Fn->Name << "': " << Message
+         << "\n";
+  return false;
 }
 
-Value *BlockASTnode::codegen(){
-  Value *Rvalue;
-  std::vector<AllocaInst*> temp;
-  int size = declarations.size(); 
-  if(size > 0){
-    Function *func = Builder.GetInsertBlock()->getParent();
-    Type *type;
-    Value *value;
+//===----------------------------------------------------------------------===//
+// AST Printer
+//===----------------------------------------------------------------------===//
 
-    for (size_t i = 0; i < size; i++)
-    {
-      if(declarations[i]->getType() == INT_TOK){
-        type = Type::getInt32Ty(TheContext);
-        value = ConstantInt::get(TheContext, APInt(32,0));
-      }
-      else if(declarations[i]->getType() == BOOL_TOK){
-        type = Type::getInt1Ty(TheContext);
-        value = ConstantInt::get(TheContext, APInt(1,0));
-      }
-      else if(declarations[i]->getType() == FLOAT_TOK){
-        type = Type::getFloatTy(TheContext);
-        value = ConstantFP::get(TheContext, APFloat(0.0));
-      }
-      IRBuilder<> Tmp(&func->getEntryBlock(), func->getEntryBlock().begin());
-      AllocaInst *allocation = Tmp.CreateAlloca(type, 0, declarations[i]->get_name().c_str());
+/// ASTDumper - Streams an AST to a raw_ostream as it is walked, either as an
+/// indented tree or as JSON lines with one object per node. Each node's dump()
+/// calls begin(), then attr()/literal() for its own fields, then child() for
+/// each child, then end(); a node's line is finished when its first child or
+/// its end() arrives, so nothing is buffered beyond the current line.
+class ASTDumper {
+public:
+  enum Format { NoDump, Tree, JSONLines };
 
-      temp.push_back(NamedValues[declarations[i]->get_name()]);
-      NamedValues[declarations[i]->get_name()] = allocation;
+private:
+  raw_ostream &OS;
+  Format Fmt;
+  unsigned NextId = 0;
+  SmallVector<unsigned, 32> Open; // Ids of the nodes being dumped
+  StringRef Role;                 // Role of the next node within its parent
+  bool LineOpen = false;
+
+  void finishLine() {
+    if (!LineOpen)
+      return;
+    if (Fmt == JSONLines)
+      OS << '}';
+    OS << '\n';
+    LineOpen = false;
+  }
+
+public:
+  ASTDumper(raw_ostream &OS, Format Fmt) : OS(OS), Fmt(Fmt) {}
+  ~ASTDumper() { finishLine(); }
+
+  void begin(StringRef Kind) {
+    finishLine();
+    unsigned Id = NextId++;
+    if (Fmt == Tree) {
+      for (size_t i = 1; i < Open.size(); i++)
+        OS << "|  ";
+      if (!Open.empty())
+        OS << "├──";
+      if (!Role.empty())
+        OS << Role << ": ";
+      OS << Kind;
+    } else {
+      OS << "{\"id\":" << Id;
+      if (!Open.empty())
+        OS << ",\"parent\":" << Open.back();
+      if (!Role.empty())
+        OS << ",\"role\":\"" << Role << '"';
+      OS << ",\"kind\":\"" << Kind << '"';
     }
+    Open.push_back(Id);
+    Role = StringRef();
+    LineOpen = true;
   }
-  
-  int  size2 = statements.size();
-  for (size_t i = 0; i < size2; i++)
-  {
-    Rvalue = statements.at(i)->codegen();
+
+  /// attr - A string field of the current node.
+  void attr(StringRef Name, StringRef Value) {
+    assert(LineOpen && "attributes must precede children");
+    if (Fmt == Tree) {
+      OS << ' ' << Name << ": " << Value;
+    } else {
+      OS << ",\"" << Name << "\":\"";
+      OS.write_escaped(Value);
+      OS << '"';
+    }
   }
-  int size3 = declarations.size();
-  for (size_t i = 0; i < size3; i++)
-  {
-    NamedValues[declarations[i]->get_name()] = temp[i];
+
+  /// literal - A number or boolean field, printed as is in both formats.
+  void literal(StringRef Name, StringRef Text) {
+    assert(LineOpen && "attributes must precede children");
+    if (Fmt == Tree)
+      OS << ' ' << Name << ": " << Text;
+    else
+      OS << ",\"" << Name << "\":" << Text;
   }
 
-  return Rvalue;
-}
+  void child(const ASTnode *Node, StringRef ChildRole = StringRef()) {
+    if (!Node)
+      return;
+    Role = ChildRole;
+    Node->dump(*this);
+  }
 
+  void end() {
+    finishLine();
+    Open.pop_back();
+  }
+};
 
+void IntASTnode::dump(ASTDumper &D) const {
+  D.begin("Int");
+  D.literal("value", std::to_string(Val));
+  D.end();
+}
 
-Value *programASTnode::codegen(){
-  Value *declarations;
-  int size = externList.size();
-  for (size_t i = 0; i < size; i++)
-  {
-    externList.at(i)->codegen();
-  }
-  int size2 = declList.size();
-  for (size_t i = 0; i < size2; i++)
-  {
-    declarations = declList.at(i)->codegen();
+void floatASTnode::dump(ASTDumper &D) const {
+  D.begin("Float");
+  if (std::isfinite(Val)) {
+    // Enough digits to read back the same float.
+    char Text[32];
+    snprintf(Text, sizeof(Text), "%.9g", Val);
+    D.literal("value", Text);
+  } else {
+    // JSON has no number for these.
+    D.attr("value", std::isnan(Val) ? "nan" : Val > 0 ? "inf" : "-inf");
   }
-  return declarations;
+  D.end();
 }
 
+void boolASTnode::dump(ASTDumper &D) const {
+  D.begin("Bool");
+  D.literal("value", Val ? "true" : "false");
+  D.end();
+}
 
+void notAndNegativeASTnode::dump(ASTDumper &D) const {
+  D.begin("Unary");
+  D.attr("op", StringRef(&prefix, 1));
+  D.child(expression);
+  D.end();
+}
 
-//===----------------------------------------------------------------------===//
-// AST Printer
-//===----------------------------------------------------------------------===//
+void typeASTnode::dump(ASTDumper &D) const {
+  D.begin("Type");
+  D.attr("name", getTokenSpelling(token.type));
+  D.end();
+}
+
+void returnASTnode::dump(ASTDumper &D) const {
+  D.begin("Return");
+  D.child(expression);
+  D.end();
+}
+
+void identASTnode::dump(ASTDumper &D) const {
+  D.begin("Ident");
+  D.attr("name", getName());
+  D.end();
+}
+
+void globalASTnode::dump(ASTDumper &D) const {
+  D.begin("VarDecl");
+  D.attr("name", get_name());
+  D.attr("type", getTokenSpelling(getType()));
+  D.end();
+}
+
+void BlockASTnode::dump(ASTDumper &D) const {
+  D.begin("Block");
+  for (globalASTnode *Decl : declarations)
+    D.child(Decl);
+  for (ASTnode *Stmt : statements)
+    D.child(Stmt);
+  D.end();
+}
+
+void ifASTnode::dump(ASTDumper &D) const {
+  D.begin("If");
+  D.child(expr, "cond");
+  D.child(block, "then");
+  D.child(elseBlock, "else");
+  D.end();
+}
+
+void assignmentASTnode::dump(ASTDumper &D) const {
+  D.begin("Assign");
+  D.attr("name", ident->getName());
+  D.child(expr);
+  D.end();
+}
+
+void parameterASTnode::dump(ASTDumper &D) const {
+  D.begin("Param");
+  if (identifier)
+    D.attr("name", getName());
+  D.attr("type", getTokenSpelling(type->getType()));
+  D.end();
+}
+
+void expressionASTnode::dump(ASTDumper &D) const {
+  D.begin("Binary");
+  D.attr("op", getBinOpSpelling(Op));
+  D.child(left);
+  D.child(right);
+  D.end();
+}
+
+void functionCall::dump(ASTDumper &D) const {
+  D.begin("Call");
+  D.attr("callee", name->getName());
+  for (ASTnode *Arg : arguments)
+    D.child(Arg);
+  D.end();
+}
+
+void externASTnode::dump(ASTDumper &D) const {
+  D.begin("Extern");
+  D.attr("name", getName());
+  D.attr("type", getTokenSpelling(type->getType()));
+  for (parameterASTnode *Param : parameters)
+    D.child(Param);
+  D.end();
+}
+
+void functionASTnode::dump(ASTDumper &D) const {
+  D.begin("Function");
+  D.child(function, "prototype");
+  D.child(funcBody, "body");
+  D.end();
+}
+
+void whileASTnode::dump(ASTDumper &D) const {
+  D.begin("While");
+  D.child(expr, "cond");
+  D.child(stmt, "body");
+  D.end();
+}
 
-inline llvm::raw_ostream &operator<<(llvm::raw_ostream &os,
-                                     const ASTnode &ast) {
-  os << ast.to_string();
-  return os;
+void programASTnode::dump(ASTDumper &D) const {
+  D.begin("Program");
+  for (externASTnode *Extern : externList)
+    D.child(Extern);
+  for (ASTnode *Decl : declList)
+    D.child(Decl);
+  D.end();
 }
 
 //===----------------------------------------------------------------------===//
 // Main driver code.
 //===----------------------------------------------------------------------===//
 
+static cl::OptionCategory MiniCCategory("MiniC compiler options");
+
+static cl::opt<std::string> InputFilename(cl::Positional, cl::Required,
+                                          cl::desc("<input file>"),
+                                          cl::cat(MiniCCategory));
+
+static cl::list<std::string> RunArgs(cl::Positional, cl::ZeroOrMore,
+                                     cl::desc("<arguments for --run>"),
+                                     cl::cat(MiniCCategory));
+
+static cl::opt<std::string> RunFunction(
+    "run", cl::cat(MiniCCategory), cl::value_desc("function"),
+    cl::desc("Compile the program in memory and call the function with the "
+             "arguments after the input file, instead of writing output"));
+
+static cl::opt<bool> RunEager(
+    "run-eager", cl::cat(MiniCCategory),
+    cl::desc("With --run, compile the whole program before calling the "
+             "function, rather than each function when it is first called"));
+
+static cl::opt<bool> Interpret(
+    "interpret", cl::cat(MiniCCategory),
+    cl::desc("With --run, run the program in a bytecode interpreter instead "
+             "of compiling it"));
+
+static cl::opt<unsigned> JITThreads(
+    "jit-threads", cl::init(2), cl::cat(MiniCCategory),
+    cl::desc("Threads --run compiles on, speculatively compiling the callees "
+             "of each function compiled; 0 compiles only what is called "
+             "(default 2)"));
+
+static cl::opt<std::string> JITCache(
+    "jit-cache", cl::cat(MiniCCategory), cl::value_desc("directory"),
+    cl::desc("Keep the machine code --run compiles in a directory, and load "
+             "it from there when the same code runs again"));
+
+static cl::opt<unsigned> JITCacheSize(
+    "jit-cache-size", cl::init(64), cl::cat(MiniCCategory),
+    cl::value_desc("MiB"),
+    cl::desc("Evict the least recently used code from the --jit-cache "
+             "directory beyond this size (default 64; 0 for no limit)"));
+
+static cl::opt<unsigned> BenchASTTraversal(
+    "bench-ast-traversal", cl::Hidden, cl::init(0), cl::cat(MiniCCategory),
+    cl::desc("Time N traversals of the pointer and flat ASTs, then exit"));
+
+static cl::opt<unsigned> BenchModuleIO(
+    "bench-module-io", cl::Hidden, cl::init(0), cl::cat(MiniCCategory),
+    cl::desc("Time N text and bitcode round trips of the module, then exit"));
+
+static cl::opt<unsigned> LexThreads(
+    "lex-threads", cl::Hidden, cl::init(0), cl::cat(MiniCCategory),
+    cl::desc("Lex in parallel on N threads (default 0: one per hardware "
+             "thread)"));
+
+static cl::opt<unsigned> LexParallelThreshold(
+    "lex-parallel-threshold", cl::Hidden, cl::init(4 << 20),
+    cl::cat(MiniCCategory), cl::value_desc("bytes"),
+    cl::desc("Lex sources of at least this size in parallel chunks of at "
+             "least a quarter of it"));
+
+static cl::opt<bool> TimePhases("time-phases", cl::cat(MiniCCategory),
+                                cl::desc("Report the time spent in each "
+                                         "compiler phase"));
+
+static cl::opt<bool> SyntaxOnly("syntax-only", cl::cat(MiniCCategory),
+                                cl::desc("Stop after lexing and parsing"));
+
+static cl::opt<unsigned> OptLevel("O", cl::Prefix, cl::ZeroOrMore, cl::init(0),
+                                  cl::cat(MiniCCategory),
+                                  cl::desc("Optimization level: -O0, -O1, -O2 "
+                                           "or -O3 (default -O0)"));
+
+static cl::opt<OutputKind> Emit(
+    cl::init(OutputKind::IR), cl::cat(MiniCCategory),
+    cl::desc("Output (default: textual IR):"),
+    cl::values(clEnumValN(OutputKind::Object, "c", "Emit an object file"),
+               clEnumValN(OutputKind::Assembly, "S", "Emit assembly"),
+               clEnumValN(OutputKind::Bitcode, "emit-bc", "Emit LLVM bitcode")));
+
+static cl::opt<bool> ModuleSummary(
+    "module-summary", cl::cat(MiniCCategory),
+    cl::desc("With --emit-bc, optimize for a ThinLTO link and write a module "
+             "summary for it"));
+
+static cl::opt<std::string> OutputFilename(
+    "o", cl::cat(MiniCCategory), cl::value_desc("filename"),
+    cl::desc("Output file (default: output.ll, output.bc, output.s or "
+             "output.o)"));
+
+static cl::opt<std::string> MCPU("mcpu", cl::cat(MiniCCategory),
+                                 cl::value_desc("cpu-name"),
+                                 cl::init("native"),
+                                 cl::desc("Target CPU (default: native, the "
+                                          "host CPU and its features)"));
+
+static cl::list<std::string> MAttrs("mattr", cl::CommaSeparated,
+                                    cl::cat(MiniCCategory),
+                                    cl::value_desc("+a1,-a2,..."),
+                                    cl::desc("Enable or disable target "
+                                             "features"));
+
+static cl::opt<std::string> FunctionPasses(
+    "function-passes", cl::cat(MiniCCategory), cl::value_desc("pipeline"),
+    cl::desc("Run a pass pipeline, in opt's -passes syntax, on each function "
+             "as it is generated"));
+
+static cl::opt<bool> NoFold("no-fold", cl::cat(MiniCCategory),
+                            cl::desc("Do not fold constants before code "
+                                     "generation"));
+
+static cl::opt<ASTDumper::Format> DumpAST(
+    "dump-ast", cl::ValueOptional, cl::init(ASTDumper::NoDump),
+    cl::cat(MiniCCategory), cl::desc("Print the AST to stdout"),
+    cl::values(clEnumValN(ASTDumper::Tree, "tree", "As an indented tree"),
+               clEnumValN(ASTDumper::Tree, "", "As an indented tree"),
+               clEnumValN(ASTDumper::JSONLines, "json",
+                          "As JSON lines, one object per node")));
+
+static const char *PhaseGroup = "mccomp";
+static const char *PhaseGroupDesc = "MiniC compiler phases";
+
+/// runFunction - Implement --run: JIT-compile M and call RunFunction with
+/// RunArgs.
+static int runFunction(std::unique_ptr<Module> M, TargetMachine &TM,
+                       const FunctionCallGraph &Calls,
+                       const StringInterner &Symbols) {
+  Function *F = M->getFunction(RunFunction);
+  if (!F || F->isDeclaration()) {
+    errs() << "Function '" << RunFunction << "' is not defined\n";
+    return 1;
+  }
+  Type *RetTy = F->getReturnType();
+  SmallVector<Constant *, 8> Values;
+  if (!parseRunArguments(RunFunction, F->getFunctionType()->params(), RunArgs,
+                         Values))
+    return 1;
+  SmallVector<uint64_t, 8> Args(Values.size());
+  for (unsigned i = 0; i != Values.size(); ++i) {
+    if (auto *CI = dyn_cast<ConstantInt>(Values[i])) {
+      int32_t Value = CI->getZExtValue();
+      memcpy(&Args[i], &Value, sizeof(Value));
+    } else {
+      float Value = cast<ConstantFP>(Values[i])->getValueAPF().convertToFloat();
+      memcpy(&Args[i], &Value, sizeof(Value));
+    }
+  }
+  addRunWrapper(*M, *F);
+
+  JITOptions Opts;
+  Opts.Lazy = !RunEager;
+  Opts.NumThreads = JITThreads;
+  std::unique_ptr<JITObjectCache> Cache;
+  if (!JITCache.empty()) {
+    if (std::error_code EC = sys::fs::create_directories(JITCache)) {
+      errs() << "Could not create the JIT cache '" << JITCache
+             << "': " << EC.message() << "\n";
+      return 1;
+    }
+    Cache = std::make_unique<JITObjectCache>(JITCache, TM);
+    Opts.Cache = Cache.get();
+  }
+
+  std::unique_ptr<orc::LLLazyJIT> J;
+  JITTargetAddress Wrapper;
+  {
+    NamedRegionTimer T("jit", "JIT compilation", PhaseGroup, PhaseGroupDesc,
+                       TimePhases);
+    if (Error Err = compileForRun(TM,
+                                  orc::ThreadSafeModule(std::move(M), TheTSC),
+                                  Opts, Calls, Symbols, J, Wrapper)) {
+      errs() << "JIT compilation failed: " << toString(std::move(Err)) << "\n";
+      return 1;
+    }
+  }
+  fflush(stdout); // Keep our output ahead of the program's
+  {
+    // Lazily compiled functions are compiled during execution.
+    NamedRegionTimer T("run", "Execution", PhaseGroup, PhaseGroupDesc,
+                       TimePhases);
+    callRunWrapper(Wrapper, RetTy, RunFunction, Args.data());
+  }
+  if (Cache) {
+    J.reset(); // Let speculative compiles finish and reach the cache
+    Cache->prune(uint64_t(JITCacheSize) << 20);
+  }
+  return 0;
+}
+
+/// interpretFunction - Implement --run --interpret: compile Program to
+/// bytecode and call RunFunction with RunArgs in the interpreter.
+static int interpretFunction(ASTnode &Program,
+                             const StringInterner &Symbols) {
+  BytecodeModule M;
+  {
+    NamedRegionTimer T("bytecode", "Bytecode compilation", PhaseGroup,
+                       PhaseGroupDesc, TimePhases);
+    BytecodeCompiler C(M, Symbols);
+    Program.compile(C, AnyReg);
+    if (!C.finish())
+      return 1;
+  }
+  const BytecodeFunction *F = M.lookup(RunFunction);
+  if (!F || !F->isDefined()) {
+    errs() << "Function '" << RunFunction << "' is not defined\n";
+    return 1;
+  }
+  SmallVector<Type *, 8> ParamTys;
+  for (MiniCType Ty : F->ParamTys)
+    ParamTys.push_back(getLLVMType(Ty));
+  SmallVector<Constant *, 8> Values;
+  if (!parseRunArguments(RunFunction, ParamTys, RunArgs, Values))
+    return 1;
+  SmallVector<Reg, 8> Args;
+  for (Constant *C : Values) {
+    Reg Arg;
+    if (auto *CI = dyn_cast<ConstantInt>(C))
+      Arg.I = int32_t(CI->getZExtValue());
+    else
+      Arg.F = cast<ConstantFP>(C)->getValueAPF().convertToFloat();
+    Args.push_back(Arg);
+  }
+
+  fflush(stdout); // Keep our output ahead of the program's
+  Reg Result;
+  {
+    NamedRegionTimer T("run", "Execution", PhaseGroup, PhaseGroupDesc,
+                       TimePhases);
+    Interpreter I(M);
+    if (!I.run(*F, Args, Result))
+      return 1;
+  }
+  printRunResult(RunFunction, getLLVMType(F->RetTy), Result.I, Result.F);
+  return 0;
+}
+
 int main(int argc, char **argv) {
-  if (argc == 2) {
-    pFile = fopen(argv[1], "r");
-    if (pFile == NULL)
-      perror("Error opening file");
-  } else {
-    std::cout << "Usage: ./code InputFile\n";
+  llvm_shutdown_obj Shutdown; // Prints the -time-phases report on exit
+  cl::HideUnrelatedOptions(MiniCCategory);
+  cl::ParseCommandLineOptions(argc, argv, "MiniC compiler\n");
+  if (OptLevel > 3) {
+    errs() << "Invalid optimization level -O" << OptLevel << "\n";
+    return 1;
+  }
+  if (ModuleSummary && Emit != OutputKind::Bitcode) {
+    errs() << "--module-summary requires --emit-bc\n";
+    return 1;
+  }
+  if (!RunFunction.empty() &&
+      (Emit.getNumOccurrences() || OutputFilename.getNumOccurrences())) {
+    errs() << "--run writes no output file\n";
+    return 1;
+  }
+  if (RunFunction.empty() && Interpret) {
+    errs() << "--interpret requires --run\n";
+    return 1;
+  }
+  if (RunFunction.empty() && !RunArgs.empty()) {
+    errs() << "Arguments after the input file are only accepted with --run\n";
+    return 1;
+  }
+
+  InitializeNativeTarget();
+  InitializeNativeTargetAsmPrinter();
+  std::string TargetError;
+  std::unique_ptr<TargetMachine> TM =
+      createHostTargetMachine(OptLevel, MCPU, MAttrs, TargetError);
+  if (!TM) {
+    errs() << "Could not target the host: " << TargetError << "\n";
     return 1;
   }
+  Optimizer Opt(*TM, OptLevel);
+  if (!FunctionPasses.empty())
+    if (Error Err = Opt.setFunctionPipeline(FunctionPasses, TimePhases)) {
+      errs() << "Invalid --function-passes pipeline: "
+             << toString(std::move(Err)) << "\n";
+      return 1;
+    }
 
-  // initialize line number and column numbers to zero
-  lineNo = 1;
-  columnNo = 1;
+  std::unique_ptr<SourceBuffer> Source;
+  auto SourceOrErr = SourceBuffer::open(InputFilename);
+  if (!SourceOrErr) {
+    errs() << "Error opening file '" << InputFilename
+           << "': " << SourceOrErr.getError().message() << "\n";
+    return 1;
+  }
+  Source = std::move(*SourceOrErr);
 
   // get the first token
   // getNextToken();
@@ -2951,44 +6403,92 @@ int main(int argc, char **argv) {
   //           CurTok.type);
   //   getNextToken();
   // }
-  getNextToken();
-  static std::unique_ptr<ASTnode> graphic = parser();
+  ASTContext AST;
+  StringInterner Symbols;
+  ParallelLexOptions LexOpts;
+  LexOpts.Threshold = LexParallelThreshold;
+  LexOpts.Threads = LexThreads;
+  Parser TheParser(*Source, AST, Symbols, errs(), LexOpts);
+  ASTnode *graphic;
+  {
+    NamedRegionTimer T("parse", "Lexing and parsing", PhaseGroup,
+                       PhaseGroupDesc, TimePhases);
+    graphic = TheParser.parse();
+  }
+  if (BenchASTTraversal && graphic)
+    return benchmarkTraversal(*graphic, BenchASTTraversal);
   //
-  if(errorCount > 0) printf("============================\n");
-  printf("%d Errors found\n", errorCount);
+  if(TheParser.getErrorCount() > 0) fprintf(stderr, "============================\n");
+  fprintf(stderr, "%d Errors found\n", TheParser.getErrorCount());
   fprintf(stderr, "Lexer Finished\n");
-  
+  if (DumpAST != ASTDumper::NoDump && graphic) {
+    ASTDumper Dumper(outs(), DumpAST);
+    Dumper.child(graphic);
+  }
+  if (SyntaxOnly)
+    return TheParser.getErrorCount() > 0;
 
   // Make the module, which holds all the code.
   TheModule = std::make_unique<Module>("mini-c", TheContext);
+  TheModule->setTargetTriple(TM->getTargetTriple().str());
+  TheModule->setDataLayout(TM->createDataLayout());
 
 
   // Run the parser now.
   //parser();
   fprintf(stderr, "Parsing Finished\n");
 
-  outs() << *graphic << '\n';
-
-  //********************* Start printing final IR **************************
-  // Print out all of the generated code into a file called output.ll
-
-  graphic->codegen();
-
-  auto Filename = "output.ll";
-  std::error_code EC;
-  raw_fd_ostream dest(Filename, EC, sys::fs::F_None);
+  if (TheParser.getErrorCount() > 0 || !graphic)
+    return 1;
 
-  if (EC) {
-    errs() << "Could not open file: " << EC.message();
+  unsigned SemaErrors;
+  FunctionCallGraph Calls;
+  {
+    NamedRegionTimer T("sema", "Semantic analysis", PhaseGroup,
+                       PhaseGroupDesc, TimePhases);
+    Sema S(Symbols);
+    graphic->analyze(S);
+    SemaErrors = S.getErrorCount();
+    Calls = S.takeCallGraph();
+  }
+  if (SemaErrors > 0) {
+    printf("%u semantic errors found\n", SemaErrors);
     return 1;
   }
-  // std::cout << "\n---------------IR--------------" << '\n';
-  // TheModule->print(errs(), nullptr); // print IR to terminal
-  // std::cout << "\n---------------IR--------------" << std::endl;
-  TheModule->print(dest, nullptr);
-  //********************* End printing final IR ****************************
 
+  if (!NoFold) {
+    NamedRegionTimer T("fold", "Constant folding", PhaseGroup, PhaseGroupDesc,
+                       TimePhases);
+    ASTFolder Folder(AST);
+    graphic->fold(Folder);
+  }
+  if (Interpret)
+    return interpretFunction(*graphic, Symbols);
 
-  fclose(pFile); // close the file that contains the code that was parsed
-  return 0;
+  {
+    NamedRegionTimer T("codegen", "Code generation", PhaseGroup,
+                       PhaseGroupDesc, TimePhases);
+    TheOptimizer = &Opt;
+    prepareCodegen(Symbols);
+    graphic->codegen();
+  }
+
+  // --run optimizes as the JIT compiles, so as to skip code it has cached.
+  if (RunFunction.empty()) {
+    NamedRegionTimer T("opt", "Optimization", PhaseGroup, PhaseGroupDesc,
+                       TimePhases);
+    Opt.runOnModule(*TheModule, ModuleSummary);
+  }
+  if (BenchModuleIO)
+    return benchmarkModuleIO(*TheModule, BenchModuleIO);
+  if (!RunFunction.empty())
+    return runFunction(std::move(TheModule), *TM, Calls, Symbols);
+
+  StringRef Filename = OutputFilename.empty()
+                           ? getDefaultOutputFilename(Emit)
+                           : StringRef(OutputFilename);
+  NamedRegionTimer T("emit", "Output", PhaseGroup, PhaseGroupDesc, TimePhases);
+  const ModuleSummaryIndex *Summary =
+      ModuleSummary ? &Opt.getModuleSummary(*TheModule) : nullptr;
+  return emitModule(*TheModule, *TM, Emit, Filename, Summary) ? 0 : 1;
 }
\ No newline at end of file
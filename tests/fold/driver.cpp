@@ -0,0 +1,28 @@
+#include <iostream>
+#include <cstdio>
+
+// clang++ driver.cpp output.ll -o fold
+
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+extern "C" DLLEXPORT int print_int(int X) {
+  fprintf(stderr, "%d\n", X);
+  return 0;
+}
+
+extern "C" {
+    int fold(int n);
+}
+
+int main() {
+
+    if(fold(2) == 35)
+      std::cout << "PASSED Result: " << fold(2) << std::endl;
+    else
+      std::cout << "FALIED Result: " << fold(2) << std::endl;
+}
@@ -0,0 +1,41 @@
+// MiniC program whose constants are folded before code generation
+
+extern int print_int(int X);
+
+int fold(int n) {
+  int k;
+  int acc;
+  float f;
+  bool debug;
+
+  k = (3 + 4) * 2 - 10 / 3;   // 11, assigned once: propagated
+  debug = !(k > 10 || false);  // false
+  f = 1 + 0.5;
+  acc = n;
+
+  if (debug) {
+    acc = acc * 1000;
+  }
+
+  while (debug && acc > 0) {
+    acc = acc - 1;
+  }
+
+  if (k == 11) {
+    int n;
+    n = -k % 4 + 4;            // 1
+    acc = acc + n;
+  } else {
+    acc = 0;
+  }
+
+  while (acc < k * 2) {
+    acc = acc + 5;
+  }
+
+  if (f * 2.0 > 2.5) {
+    acc = acc + 1;
+  }
+  print_int(acc);
+  return acc + k;
+}
@@ -0,0 +1,28 @@
+#include <iostream>
+#include <cstdio>
+
+// clang++ driver.cpp output.ll -o return
+
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+extern "C" DLLEXPORT int print_int(int X) {
+  fprintf(stderr, "%d\n", X);
+  return 0;
+}
+
+extern "C" {
+    int returner(int n);
+}
+
+int main() {
+
+    if(returner(5) == 121)
+      std::cout << "PASSED Result: " << returner(5) << std::endl;
+    else
+      std::cout << "FALIED Result: " << returner(5) << std::endl;
+}
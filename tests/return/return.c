@@ -0,0 +1,47 @@
+// MiniC program to test early returns and implicit conversions
+extern int print_int(int X);
+
+float scale(float x) {
+  return x * 2;
+}
+
+float halve(int n) {
+  return n / 2;
+}
+
+int clamp(int n, int lo, int hi) {
+  if (n < lo) {
+    return lo;
+  }
+  if (n > hi) {
+    return hi;
+  }
+  return n;
+}
+
+int firstOver(int limit) {
+  int i;
+  i = 1;
+  while (true) {
+    if (i * i > limit) {
+      return i;
+    }
+    i = i + 1;
+  }
+  return 0;
+}
+
+int returner(int n) {
+  float f;
+  int converted;
+  // n is converted to float for scale; halve's int quotient on its return
+  f = scale(n) + halve(n);
+  converted = 0;
+  if (f == 12.0) {
+    converted = 100;
+  }
+  print_int(clamp(n, 0, 10));
+  print_int(clamp(0 - n, 0, 10));
+  print_int(clamp(n * 3, 0, 10));
+  return firstOver(n * n) + clamp(n, 0, 10) + clamp(n * 3, 0, 10) + converted;
+}
@@ -0,0 +1,28 @@
+#include <iostream>
+#include <cstdio>
+
+// clang++ driver.cpp output.ll -o scope
+
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+extern "C" DLLEXPORT int print_int(int X) {
+  fprintf(stderr, "%d\n", X);
+  return 0;
+}
+
+extern "C" {
+    int scope(int n);
+}
+
+int main() {
+
+    if(scope(4) == 308)
+      std::cout << "PASSED Result: " << scope(4) << std::endl;
+    else
+      std::cout << "FALIED Result: " << scope(4) << std::endl;
+}
@@ -0,0 +1,36 @@
+// MiniC program to test nested scopes and shadowing
+extern int print_int(int X);
+
+int x;
+float y;
+
+int inner(int n) {
+  x = n;
+  {
+    int x;
+    x = n * 10;
+    {
+      float x;
+      x = 0.5;
+      y = x + n;
+    }
+    x = x + 1;
+    print_int(x);
+  }
+  return x;
+}
+
+int scope(int n) {
+  int total;
+  int i;
+  total = inner(n);
+  i = 0;
+  while (i < 3) {
+    int n;
+    n = i * 100;
+    total = total + n;
+    i = i + 1;
+  }
+  print_int(total);
+  return total + n;
+}
@@ -0,0 +1,28 @@
+#include <iostream>
+#include <cstdio>
+
+// clang++ driver.cpp output.ll -o shortcircuit
+
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+extern "C" DLLEXPORT int print_int(int X) {
+  fprintf(stderr, "%d\n", X);
+  return 0;
+}
+
+extern "C" {
+    int shortcircuit(int n);
+}
+
+int main() {
+
+    if(shortcircuit(3) == 121011)
+      std::cout << "PASSED Result: " << shortcircuit(3) << std::endl;
+    else
+      std::cout << "FALIED Result: " << shortcircuit(3) << std::endl;
+}
@@ -0,0 +1,54 @@
+// MiniC program to test short-circuit evaluation of && and ||
+
+extern int print_int(int X);
+
+int calls;
+
+bool count(bool result) {
+  calls = calls + 1;
+  return result;
+}
+
+int shortcircuit(int n) {
+  int d;
+  int hits;
+  bool b;
+
+  calls = 0;
+  hits = 0;
+  d = n - 3;
+
+  // The division must not run when the left operand rules it out
+  if (d != 0 && n / d > 1) {
+    hits = hits + 100;
+  }
+  if (d == 0 || n / d > 1) {
+    hits = hits + 1;
+  }
+
+  // A call on the right runs only when the left does not decide the result
+  b = n < 0 && count(true);
+  b = n > 0 || count(false);
+  b = n > 0 && count(true);
+  if (b) {
+    hits = hits + 10;
+  }
+  b = n < 0 || count(false);
+
+  // Cheap operands
+  if (n > 0 && d < 1) {
+    hits = hits + 1000;
+  }
+
+  // A cheap right side that would overflow is never evaluated by the program,
+  // so it must not decide the result when it is speculated
+  if (n < 1 && n + 2147483647 > 0) {
+    hits = hits + 200000;
+  }
+  if (n > 0 || n * 1000000000 > 0) {
+    hits = hits + 100000;
+  }
+
+  print_int(calls);
+  return hits + calls * 10000;
+}
@@ -24,6 +24,8 @@ make mccomp
 
 COMP=$DIR/mccomp
 echo $COMP
+# Extra compiler flags for every test, e.g. MCFLAGS=-O2 tests/tests.sh
+MCFLAGS=${MCFLAGS:-}
 
 function validate {
   $1 > perf_out
@@ -38,7 +40,7 @@ echo "Test *****"
 cd tests/addition/
 pwd
 rm -rf output.ll add
-"$COMP" ./addition.c
+"$COMP" $MCFLAGS ./addition.c
 $CLANG driver.cpp output.ll  -o add
 validate "./add"
 
@@ -46,71 +48,183 @@ validate "./add"
 cd ../factorial 
 pwd
 rm -rf output.ll fact
-"$COMP" ./factorial.c
+"$COMP" $MCFLAGS ./factorial.c
 $CLANG driver.cpp output.ll -o fact
 validate "./fact"
 
 cd ../fibonacci
 pwd
 rm -rf output.ll fib
-"$COMP" ./fibonacci.c
+"$COMP" $MCFLAGS ./fibonacci.c
 $CLANG driver.cpp output.ll -o fib
 validate "./fib"
 
 cd ../pi
 pwd
 rm -rf output.ll pi
-"$COMP" ./pi.c
+"$COMP" $MCFLAGS ./pi.c
 $CLANG driver.cpp output.ll -o pi
 validate "./pi"
 
 cd ../while
 pwd
 rm -rf output.ll while
-"$COMP" ./while.c
+"$COMP" $MCFLAGS ./while.c
 $CLANG driver.cpp output.ll -o while
 validate "./while"
 
 cd ../void
 pwd
 rm -rf output.ll void
-"$COMP" ./void.c 
+"$COMP" $MCFLAGS ./void.c 
 $CLANG driver.cpp output.ll -o void
 validate "./void"
 
 cd ../cosine
 pwd
 rm -rf output.ll cosine
-"$COMP" ./cosine.c
+"$COMP" $MCFLAGS ./cosine.c
 $CLANG driver.cpp output.ll -o cosine
 validate "./cosine"
 
 cd ../unary
 pwd
 rm -rf output.ll unary
-"$COMP" ./unary.c
+"$COMP" $MCFLAGS ./unary.c
 $CLANG driver.cpp output.ll -o unary
 validate "./unary"
 
 cd ../recurse
 pwd
 rm -rf output.ll recurse
-"$COMP" ./recurse.c
+"$COMP" $MCFLAGS ./recurse.c
 $CLANG driver.cpp output.ll -o recurse
 validate "./recurse"
 
 cd ../rfact
 pwd
 rm -rf output.ll rfact
-"$COMP" ./rfact.c
+"$COMP" $MCFLAGS ./rfact.c
 $CLANG driver.cpp output.ll -o rfact
 validate "./rfact"
 
 cd ../palindrome
 pwd
 rm -rf output.ll palindrome
-"$COMP" ./palindrome.c
+"$COMP" $MCFLAGS ./palindrome.c
 $CLANG driver.cpp output.ll -o palindrome
 validate "./palindrome"
 
+cd ../return
+pwd
+rm -rf output.ll return
+"$COMP" $MCFLAGS ./return.c
+$CLANG driver.cpp output.ll -o return
+validate "./return"
+
+cd ../scope
+pwd
+rm -rf output.ll scope
+"$COMP" $MCFLAGS ./scope.c
+$CLANG driver.cpp output.ll -o scope
+validate "./scope"
+
+cd ../fold
+pwd
+rm -rf output.ll fold
+"$COMP" $MCFLAGS ./fold.c
+# The result alone would not show that anything was folded: k, debug and f
+# must be constants rather than variables, and only the loop that is left
+# may branch on a condition.
+if grep -qE "%(k|debug|f) = alloca" output.ll ||
+   [[ $(grep -c "br i1" output.ll) -gt 1 ]]; then
+  echo "fold was not folded"; echo "TEST FAILED *****"; exit 1
+fi
+$CLANG driver.cpp output.ll -o fold
+validate "./fold"
+
+cd ../shortcircuit
+pwd
+rm -rf output.ll shortcircuit
+"$COMP" $MCFLAGS ./shortcircuit.c
+$CLANG driver.cpp output.ll -o shortcircuit
+validate "./shortcircuit"
+
+# Parallel lexing, forced onto four threads with chunks of a few lines, must
+# give the same AST as a serial lex.
+echo
+echo "parallel lexing"
+"$COMP" --syntax-only --dump-ast=json ./shortcircuit.c > serial.json
+"$COMP" --syntax-only --dump-ast=json --lex-threads=4 \
+  --lex-parallel-threshold=0 ./shortcircuit.c > chunked.json
+if ! cmp serial.json chunked.json; then echo "TEST FAILED *****";exit 1; fi
+rm serial.json chunked.json
+
+# Every line --dump-ast=json writes to stdout is a JSON object.
+echo
+echo "--dump-ast=json"
+for F in ../*/*.c; do
+  if ! "$COMP" --syntax-only --dump-ast=json "$F" 2> /dev/null |
+       python3 -c 'import json, sys
+for line in sys.stdin: json.loads(line)'; then
+    echo "$F"; echo "TEST FAILED *****";exit 1
+  fi
+done
+
+# --run: compile in memory and call the function directly, no driver.
+function validate_run {
+  echo
+  echo "--run=$2"
+  "$COMP" $MCFLAGS --run="$2" "${@:3}" | grep -x "$1"
+  rc=$?; if [[ $rc != 0 ]]; then echo "TEST FAILED *****";exit $rc; fi
+}
+
+cd ../factorial
+validate_run "factorial returned 3628800" factorial ./factorial.c 10
+cd ../palindrome
+validate_run "palindrome returned true" palindrome ./palindrome.c 12321
+cd ../unary
+validate_run "unary returned 6.000000" unary ./unary.c 3 -- -2.5
+cd ../factorial
+# Once to fill the cache, once to load from it, with other arguments: they
+# are not part of the cached code, so nothing new is cached.
+validate_run "factorial returned 3628800" factorial --jit-cache=jit-cache ./factorial.c 10
+CACHED=$(ls jit-cache)
+validate_run "factorial returned 120" factorial --jit-cache=jit-cache ./factorial.c 5
+if [[ "$(ls jit-cache)" != "$CACHED" ]]; then echo "TEST FAILED *****";exit 1; fi
+# Damaged entries are compiled again, not loaded.
+for F in jit-cache/llvmcache-*; do truncate -s 100 "$F"; done
+validate_run "factorial returned 3628800" factorial --jit-cache=jit-cache ./factorial.c 10
+rm -rf jit-cache
+
+# A missing extern is reported as an error, not a crash, whether --run
+# compiles lazily or eagerly or interprets.
+echo "extern int nosuch(int x); int f(int a) { return nosuch(a); }" > missing.c
+for MODE in --jit-threads=2 --run-eager --interpret; do
+  echo
+  echo "--run=f $MODE, missing extern"
+  rc=0; "$COMP" $MCFLAGS $MODE --run=f ./missing.c 1 > /dev/null || rc=$?
+  if [[ $rc != 1 ]]; then echo "TEST FAILED *****";exit 1; fi
+done
+rm missing.c
+
+# --interpret: the same calls in the bytecode interpreter.
+validate_run "factorial returned 3628800" factorial --interpret ./factorial.c 10
+cd ../unary
+validate_run "unary returned 6.000000" unary --interpret ./unary.c 3 -- -2.5
+cd ../while
+validate_run "While returned 10" While --interpret ./while.c 3
+cd ../rfact
+validate_run "rfact returned 3628800" rfact --interpret ./rfact.c 10
+cd ../scope
+validate_run "scope returned 308" scope --interpret ./scope.c 4
+cd ../shortcircuit
+validate_run "shortcircuit returned 121011" shortcircuit --interpret ./shortcircuit.c 3
+validate_run "shortcircuit returned 220000" shortcircuit --interpret ./shortcircuit.c 0
+cd ../void
+validate_run "Void returned" Void --interpret ./void.c
+cd ../palindrome
+validate_run "palindrome returned true" palindrome --interpret ./palindrome.c 12321
+validate_run "palindrome returned false" palindrome --interpret ./palindrome.c 12345
+
 echo "***** ALL TESTS PASSED *****"